@@ -1,864 +1,5579 @@
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <map>
-#include <algorithm>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
-#include <cctype>
-#include <limits>
-#include <memory>
-
-using namespace std;
-
-// 文件路径常量
-const string TEACHER_FILE = "teachers.dat";
-const string STUDENT_FILE = "students.dat";
-const string COURSE_FILE = "courses.dat";
-const string QA_FILE = "qa_records.dat";
-
-// 课程基类
-class Course {
-protected:
-    string courseID;
-    string courseName;
-    string qaTime;
-
-public:
-    Course(string id, string name, string time) 
-        : courseID(id), courseName(name), qaTime(time) {}
-
-    virtual ~Course() {}
-    
-    string getCourseID() const { return courseID; }
-    string getCourseName() const { return courseName; }
-    string getQATime() const { return qaTime; }
-    
-    virtual string getType() const = 0;  // 纯虚函数
-    virtual void showMe() const = 0;     // 纯虚函数
-    
-    // 文件操作
-    virtual void saveToFile(ofstream& out) const {
-        out << courseID << "|" << courseName << "|" << qaTime << "|";
-    }
-    
-    virtual void loadFromFile(ifstream& in) {
-        string line;
-        getline(in, line);
-        stringstream ss(line);
-        getline(ss, courseID, '|');
-        getline(ss, courseName, '|');
-        getline(ss, qaTime, '|');
-    }
-};
-
-// 必修课程类
-class BCourse : public Course {
-public:
-    BCourse(string id, string name, string time) 
-        : Course(id, name, time) {}
-    
-    BCourse(ifstream& in) : Course("", "", "") {
-        loadFromFile(in);
-    }
-    
-    string getType() const override { return "必修"; }
-    
-    void showMe() const override {
-        cout << "课程ID: " << courseID 
-             << ", 名称: " << courseName
-             << ", 类型: 必修"
-             << ", 答疑时间: " << qaTime << endl;
-    }
-    
-    void saveToFile(ofstream& out) const override {
-        Course::saveToFile(out);
-        out << "B" << endl;
-    }
-    
-    void loadFromFile(ifstream& in) override {
-        Course::loadFromFile(in);
-        char type;
-        in >> type; in.ignore();
-    }
-};
-
-// 选修课程类
-class XCourse : public Course {
-public:
-    XCourse(string id, string name, string time) 
-        : Course(id, name, time) {}
-    
-    XCourse(ifstream& in) : Course("", "", "") {
-        loadFromFile(in);
-    }
-    
-    string getType() const override { return "选修"; }
-    
-    void showMe() const override {
-        cout << "课程ID: " << courseID 
-             << ", 名称: " << courseName
-             << ", 类型: 选修"
-             << ", 答疑时间: " << qaTime << endl;
-    }
-    
-    void saveToFile(ofstream& out) const override {
-        Course::saveToFile(out);
-        out << "X" << endl;
-    }
-    
-    void loadFromFile(ifstream& in) override {
-        Course::loadFromFile(in);
-        char type;
-        in >> type; in.ignore();
-    }
-};
-
-// 答疑信息结构
-struct QAInfo {
-    string teacherID;
-    string studentID;
-    string courseID;
-    string time;
-    int rating;
-    
-    QAInfo(string tid, string sid, string cid, string t, int r)
-        : teacherID(tid), studentID(sid), courseID(cid), time(t), rating(r) {}
-    
-    void saveToFile(ofstream& out) const {
-        out << teacherID << "|" << studentID << "|" << courseID << "|"
-            << time << "|" << rating << endl;
-    }
-    
-    void loadFromFile(ifstream& in) {
-        string line;
-        getline(in, line);
-        stringstream ss(line);
-        getline(ss, teacherID, '|');
-        getline(ss, studentID, '|');
-        getline(ss, courseID, '|');
-        getline(ss, time, '|');
-        ss >> rating; in.ignore();
-    }
-    
-    void display() const {
-        cout << "教师: " << teacherID << ", 学生: " << studentID 
-             << ", 课程: " << courseID << ", 时间: " << time 
-             << ", 评分: " << rating << "/10" << endl;
-    }
-};
-
-// 教师类
-class Teacher {
-private:
-    string teacherID;
-    string password;
-    vector<string> courses; // 教授的课程ID列表
-    vector<QAInfo> qaRecords;
-
-public:
-    Teacher() : teacherID(""), password("") {}
-    Teacher(string id, string pwd) : teacherID(id), password(pwd) {}
-    
-    string getID() const { return teacherID; }
-    string getPassword() const { return password; }
-    void setPassword(string pwd) { password = pwd; }
-    
-    void addCourse(string courseID) {
-        if (find(courses.begin(), courses.end(), courseID) == courses.end()) {
-            courses.push_back(courseID);
-            cout << "课程添加成功!" << endl;
-        } else {
-            cout << "该课程已存在!" << endl;
-        }
-    }
-    
-    void deleteCourse(string courseID) {
-        auto it = find(courses.begin(), courses.end(), courseID);
-        if (it != courses.end()) {
-            courses.erase(it);
-            cout << "课程删除成功!" << endl;
-        } else {
-            cout << "未找到该课程!" << endl;
-        }
-    }
-    
-    void searchCourses() const {
-        if (courses.empty()) {
-            cout << "暂无教授课程!" << endl;
-            return;
-        }
-        cout << "教授的课程列表:" << endl;
-        for (const auto& cid : courses) {
-            cout << "- " << cid << endl;
-        }
-    }
-    
-    void addQA(string sid, string cid, string time) {
-        qaRecords.emplace_back(teacherID, sid, cid, time, 0);
-        cout << "答疑记录添加成功!" << endl;
-    }
-    
-    void showRatings() const {
-        if (qaRecords.empty()) {
-            cout << "暂无答疑记录!" << endl;
-            return;
-        }
-        
-        vector<int> ratings;
-        for (const auto& qa : qaRecords) {
-            if (qa.rating > 0) {
-                ratings.push_back(qa.rating);
-            }
-        }
-        
-        if (ratings.empty()) {
-            cout << "暂无评分记录!" << endl;
-            return;
-        }
-        
-        int sum = 0, max = 0, min = 10;
-        for (int r : ratings) {
-            sum += r;
-            if (r > max) max = r;
-            if (r < min) min = r;
-        }
-        
-        cout << "评分统计: "
-             << "最高分: " << max << ", "
-             << "最低分: " << min << ", "
-             << "平均分: " << fixed << setprecision(1) 
-             << static_cast<double>(sum) / ratings.size() << endl;
-    }
-    
-    void displayQARecords() const {
-        if (qaRecords.empty()) {
-            cout << "暂无答疑记录!" << endl;
-            return;
-        }
-        
-        cout << "答疑记录:" << endl;
-        for (const auto& qa : qaRecords) {
-            qa.display();
-        }
-    }
-    
-    const vector<string>& getCourses() const { return courses; }
-    vector<QAInfo>& getQARecords() { return qaRecords; }
-    
-    // 文件操作
-    void saveToFile(ofstream& out) const {
-        out << teacherID << "|" << password << "|";
-        for (size_t i = 0; i < courses.size(); i++) {
-            out << courses[i];
-            if (i < courses.size() - 1) out << ",";
-        }
-        out << endl;
-    }
-    
-    void loadFromFile(ifstream& in) {
-        string line;
-        getline(in, line);
-        stringstream ss(line);
-        getline(ss, teacherID, '|');
-        getline(ss, password, '|');
-        
-        string courseList;
-        getline(ss, courseList);
-        stringstream cl(courseList);
-        string courseID;
-        while (getline(cl, courseID, ',')) {
-            if (!courseID.empty()) {
-                courses.push_back(courseID);
-            }
-        }
-    }
-};
-
-// 学生类
-class Student {
-private:
-    string studentID;
-    string password;
-    vector<string> courses; // 选修的课程ID列表
-
-public:
-    Student() : studentID(""), password("") {}
-    Student(string id, string pwd) : studentID(id), password(pwd) {}
-    
-    string getID() const { return studentID; }
-    string getPassword() const { return password; }
-    void setPassword(string pwd) { password = pwd; }
-    
-    void selectCourse(string courseID) {
-        if (find(courses.begin(), courses.end(), courseID) == courses.end()) {
-            courses.push_back(courseID);
-            cout << "课程选修成功!" << endl;
-        } else {
-            cout << "该课程已选修!" << endl;
-        }
-    }
-    
-    void unselectCourse(string courseID) {
-        auto it = find(courses.begin(), courses.end(), courseID);
-        if (it != courses.end()) {
-            courses.erase(it);
-            cout << "课程退选成功!" << endl;
-        } else {
-            cout << "未找到该课程!" << endl;
-        }
-    }
-    
-    void searchCourses() const {
-        if (courses.empty()) {
-            cout << "暂无选修课程!" << endl;
-            return;
-        }
-        cout << "选修的课程列表:" << endl;
-        for (const auto& cid : courses) {
-            cout << "- " << cid << endl;
-        }
-    }
-    
-    const vector<string>& getCourses() const { return courses; }
-    
-    // 文件操作
-    void saveToFile(ofstream& out) const {
-        out << studentID << "|" << password << "|";
-        for (size_t i = 0; i < courses.size(); i++) {
-            out << courses[i];
-            if (i < courses.size() - 1) out << ",";
-        }
-        out << endl;
-    }
-    
-    void loadFromFile(ifstream& in) {
-        string line;
-        getline(in, line);
-        stringstream ss(line);
-        getline(ss, studentID, '|');
-        getline(ss, password, '|');
-        
-        string courseList;
-        getline(ss, courseList);
-        stringstream cl(courseList);
-        string courseID;
-        while (getline(cl, courseID, ',')) {
-            if (!courseID.empty()) {
-                courses.push_back(courseID);
-            }
-        }
-    }
-};
-
-// 管理系统类
-class ManagementSystem {
-private:
-    map<string, Teacher> teachers;
-    map<string, Student> students;
-    map<string, unique_ptr<Course>> courses;
-    vector<QAInfo> allQARecords;
-    
-    // 获取当前时间
-    string getCurrentTime() {
-        time_t now = time(0);
-        tm* ltm = localtime(&now);
-        stringstream ss;
-        ss << 1900 + ltm->tm_year << "-"
-           << setfill('0') << setw(2) << 1 + ltm->tm_mon << "-"
-           << setw(2) << ltm->tm_mday << " "
-           << setw(2) << ltm->tm_hour << ":"
-           << setw(2) << ltm->tm_min;
-        return ss.str();
-    }
-    
-public:
-    ManagementSystem() {
-        loadData();
-    }
-    
-    ~ManagementSystem() {
-        saveData();
-    }
-    
-    // 加载数据
-    void loadData() {
-        // 加载教师数据
-        ifstream tfile(TEACHER_FILE);
-        if (tfile) {
-            while (tfile.peek() != EOF) {
-                Teacher t("", "");
-                t.loadFromFile(tfile);
-                teachers[t.getID()] = t;
-            }
-            tfile.close();
-        }
-        
-        // 加载学生数据
-        ifstream sfile(STUDENT_FILE);
-        if (sfile) {
-            while (sfile.peek() != EOF) {
-                Student s("", "");
-                s.loadFromFile(sfile);
-                students[s.getID()] = s;
-            }
-            sfile.close();
-        }
-        
-        // 加载课程数据
-        ifstream cfile(COURSE_FILE);
-        if (cfile) {
-            while (cfile.peek() != EOF) {
-                char type;
-                cfile >> type; cfile.ignore();
-                
-                if (type == 'B') {
-                    unique_ptr<Course> course = make_unique<BCourse>(cfile);
-                    courses[course->getCourseID()] = move(course);
-                } else if (type == 'X') {
-                    unique_ptr<Course> course = make_unique<XCourse>(cfile);
-                    courses[course->getCourseID()] = move(course);
-                }
-            }
-            cfile.close();
-        }
-        
-        // 加载答疑记录
-        ifstream qfile(QA_FILE);
-        if (qfile) {
-            while (qfile.peek() != EOF) {
-                QAInfo qa("", "", "", "", 0);
-                qa.loadFromFile(qfile);
-                allQARecords.push_back(qa);
-            }
-            qfile.close();
-        }
-    }
-    
-    // 保存数据
-    void saveData() {
-        // 保存教师数据
-        ofstream tfile(TEACHER_FILE);
-        if (tfile) {
-            for (const auto& t : teachers) {
-                t.second.saveToFile(tfile);
-            }
-            tfile.close();
-        }
-        
-        // 保存学生数据
-        ofstream sfile(STUDENT_FILE);
-        if (sfile) {
-            for (const auto& s : students) {
-                s.second.saveToFile(sfile);
-            }
-            sfile.close();
-        }
-        
-        // 保存课程数据
-        ofstream cfile(COURSE_FILE);
-        if (cfile) {
-            for (const auto& c : courses) {
-                c.second->saveToFile(cfile);
-            }
-            cfile.close();
-        }
-        
-        // 保存答疑记录
-        ofstream qfile(QA_FILE);
-        if (qfile) {
-            for (const auto& qa : allQARecords) {
-                qa.saveToFile(qfile);
-            }
-            qfile.close();
-        }
-    }
-    
-    // 用户认证
-    Teacher* authenticateTeacher(string id, string pwd) {
-        auto it = teachers.find(id);
-        if (it != teachers.end()) {
-            if (it->second.getPassword() == pwd) {
-                return &it->second;
-            }
-            return nullptr; // 密码错误
-        }
-        
-        // 新教师注册
-        teachers.emplace(id, Teacher(id, pwd));
-        return &teachers[id];
-    }
-    
-    Student* authenticateStudent(string id, string pwd) {
-        auto it = students.find(id);
-        if (it != students.end()) {
-            if (it->second.getPassword() == pwd) {
-                return &it->second;
-            }
-            return nullptr; // 密码错误
-        }
-        
-        // 新学生注册
-        students.emplace(id, Student(id, pwd));
-        return &students[id];
-    }
-    
-    // 课程管理
-    void addNewCourse(string id, string name, string time, string type) {
-        if (courses.find(id) != courses.end()) {
-            cout << "课程ID已存在!" << endl;
-            return;
-        }
-        
-        if (type == "必修") {
-            courses[id] = make_unique<BCourse>(id, name, time);
-        } else if (type == "选修") {
-            courses[id] = make_unique<XCourse>(id, name, time);
-        } else {
-            cout << "无效的课程类型!" << endl;
-            return;
-        }
-        cout << "课程创建成功!" << endl;
-    }
-    
-    Course* getCourse(string id) {
-        auto it = courses.find(id);
-        if (it != courses.end()) {
-            return it->second.get();
-        }
-        return nullptr;
-    }
-    
-    void displayAllCourses() const {
-        if (courses.empty()) {
-            cout << "暂无课程信息!" << endl;
-            return;
-        }
-        cout << "==============================================" << endl;
-        cout << "                 所有课程信息                 " << endl;
-        cout << "==============================================" << endl;
-        for (const auto& c : courses) {
-            c.second->showMe();
-        }
-        cout << "==============================================" << endl;
-    }
-    
-    // 答疑管理
-    void addQA(Teacher* t, string sid, string cid) {
-        if (!t) return;
-        
-        // 检查教师是否教授该课程
-        const vector<string>& teacherCourses = t->getCourses();
-        if (find(teacherCourses.begin(), teacherCourses.end(), cid) == teacherCourses.end()) {
-            cout << "您不教授此课程!" << endl;
-            return;
-        }
-        
-        // 检查学生是否选修该课程
-        auto sit = students.find(sid);
-        if (sit == students.end()) {
-            cout << "学生不存在!" << endl;
-            return;
-        }
-        
-        const vector<string>& studentCourses = sit->second.getCourses();
-        if (find(studentCourses.begin(), studentCourses.end(), cid) == studentCourses.end()) {
-            cout << "该学生未选修此课程!" << endl;
-            return;
-        }
-        
-        string time = getCurrentTime();
-        t->addQA(sid, cid, time);
-        allQARecords.emplace_back(t->getID(), sid, cid, time, 0);
-    }
-    
-    void rateQA(Student* s, string tid, string cid) {
-        if (!s) return;
-        
-        // 查找未评分的答疑记录
-        for (auto& qa : allQARecords) {
-            if (qa.studentID == s->getID() && 
-                qa.teacherID == tid && 
-                qa.courseID == cid && 
-                qa.rating == 0) {
-                
-                int rating;
-                do {
-                    cout << "请为本次答疑评分(1-10): ";
-                    cin >> rating;
-                    cin.ignore(numeric_limits<streamsize>::max(), '\n');//清空缓冲区
-                } while (rating < 1 || rating > 10);
-                
-                qa.rating = rating;
-                
-                // 更新教师记录中的评分
-                auto tit = teachers.find(tid);
-                if (tit != teachers.end()) {
-                    for (auto& tqa : tit->second.getQARecords()) {
-                        if (tqa.studentID == s->getID() && 
-                            tqa.courseID == cid && 
-                            tqa.rating == 0) {
-                            tqa.rating = rating;
-                            break;
-                        }
-                    }
-                }
-                
-                cout << "评分成功!" << endl;
-                return;
-            }
-        }
-        cout << "未找到可评分的答疑记录!" << endl;
-    }
-};
-
-// 用户界面函数
-void teacherMenu(Teacher* teacher, ManagementSystem& system);
-void studentMenu(Student* student, ManagementSystem& system);
-
-// 初始化系统数据
-void initializeSystemData() {
-    // 创建示例教师
-    ofstream tfile(TEACHER_FILE);
-    if (tfile) {
-        tfile << "T001|pass123|C101,C102\n";
-        tfile << "T002|pass456|C201,C203\n";
-        tfile << "T003|pass124|C301,C303\n";
-        tfile << "T004|pass135|C201,C203\n";
-        tfile << "T005|pass147|C201,C203\n";
-        tfile.close();
-    }
-    
-    // 创建示例学生
-    ofstream sfile(STUDENT_FILE);
-    if (sfile) {
-        sfile << "S1001|pass789|C101,C201\n";
-        sfile << "S1002|pass123|C102,C203\n";
-        sfile << "S1003|pass456|C302,C301\n";
-        sfile << "S1004|pass567|C302,C202\n";
-        sfile << "S1005|pass678|C303,C101\n";
-        sfile.close();
-    }
-    
-    // 创建示例课程
-    ofstream cfile(COURSE_FILE);
-    if (cfile) {
-        cfile << "B|C101|高等数学|周一 14:00-16:00|\n";
-        cfile << "X|C102|计算机基础|周三 10:00-12:00|\n";
-        cfile << "B|C201|大学英语|周二 09:00-11:00|\n";
-        cfile << "B|C202|数据结构|周四 15:00-17:00|\n";
-        cfile << "B|C203|操作系统|周四 15:00-17:00|\n";
-        cfile << "B|C301|计算机组成原理|周四 15:00-17:00|\n";
-        cfile << "X|C302|电影美学|周四 15:00-17:00|\n";
-        cfile << "X|C303|改革开放史|周四 15:00-17:00|\n";
-        cfile.close();
-    }
-}
-
-int main() {
-    // 初始化系统数据
-    initializeSystemData();
-    
-    ManagementSystem system;
-    
-    while (true) {
-        cout << "\n==============================================" << endl;
-        cout << "      教师在线答疑辅导管理系统 - 主菜单       " << endl;
-        cout << "==============================================" << endl;
-        cout << "1. 教师登录" << endl;
-        cout << "2. 学生登录" << endl;
-        cout << "3. 查看所有课程" << endl;
-        cout << "4. 退出系统" << endl;
-        cout << "==============================================" << endl;
-        cout << "请选择: ";
-        
-        int choice;
-        cin >> choice;
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        
-        if (choice == 4) {
-            system.saveData();
-            cout << "数据已保存，感谢使用!" << endl;
-            break;
-        }
-        
-        string id, pwd;
-        if (choice == 1 || choice == 2) {
-            cout << "请输入ID: ";
-            getline(cin, id);
-            cout << "请输入密码: ";
-            getline(cin, pwd);
-        }
-        
-        if (choice == 1) {
-            Teacher* teacher = system.authenticateTeacher(id, pwd);
-            if (teacher) {
-                teacherMenu(teacher, system);
-            } else {
-                cout << "登录失败! 工号或密码错误." << endl;
-            }
-        } else if (choice == 2) {
-            Student* student = system.authenticateStudent(id, pwd);
-            if (student) {
-                studentMenu(student, system);
-            } else {
-                cout << "登录失败! 学号或密码错误." << endl;
-            }
-        } else if (choice == 3) {
-            system.displayAllCourses();
-        } else {
-            cout << "无效选择!" << endl;
-        }
-    }
-    
-    return 0;
-}
-
-void teacherMenu(Teacher* teacher, ManagementSystem& system) {
-    while (true) {
-        cout << "\n==============================================" << endl;
-        cout << "      教师管理菜单 (" << teacher->getID() << ")       " << endl;
-        cout << "==============================================" << endl;
-        cout << "1. 添加课程" << endl;
-        cout << "2. 删除课程" << endl;
-        cout << "3. 查询课程" << endl;
-        cout << "4. 添加答疑记录" << endl;
-        cout << "5. 查看评分统计" << endl;
-        cout << "6. 查看答疑记录" << endl;
-        cout << "7. 修改密码" << endl;
-        cout << "8. 返回主菜单" << endl;
-        cout << "==============================================" << endl;
-        cout << "请选择: ";
-        
-        int choice;
-        cin >> choice;
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        
-        if (choice == 8) break;
-        
-        string cid, sid;
-        switch (choice) {
-            case 1: { // 添加课程
-                string id, name, time, type;
-                cout << "请输入课程ID: ";
-                getline(cin, id);
-                cout << "请输入课程名称: ";
-                getline(cin, name);
-                cout << "请输入答疑时间: ";
-                getline(cin, time);
-                cout << "请输入课程类型(必修/选修): ";
-                getline(cin, type);
-                
-                // 添加新课程到系统
-                system.addNewCourse(id, name, time, type);
-                // 添加课程到教师
-                teacher->addCourse(id);
-                break;
-            }
-                
-            case 2: // 删除课程
-                teacher->searchCourses();
-                cout << "请输入要删除的课程ID: ";
-                getline(cin, cid);
-                teacher->deleteCourse(cid);
-                break;
-                
-            case 3: // 查询课程
-                teacher->searchCourses();
-                break;
-                
-            case 4: // 添加答疑记录
-                cout << "请输入学生ID: ";
-                getline(cin, sid);
-                cout << "请输入课程ID: ";
-                getline(cin, cid);
-                system.addQA(teacher, sid, cid);
-                break;
-                
-            case 5: // 查看评分统计
-                teacher->showRatings();
-                break;
-                
-            case 6: // 查看答疑记录
-                teacher->displayQARecords();
-                break;
-                
-            case 7: { // 修改密码
-                string newPwd;
-                cout << "请输入新密码: ";
-                getline(cin, newPwd);
-                teacher->setPassword(newPwd);
-                cout << "密码修改成功!" << endl;
-                break;
-            }
-                
-            default:
-                cout << "无效选择!" << endl;
-        }
-    }
-}
-
-void studentMenu(Student* student, ManagementSystem& system) {
-    while (true) {
-        cout << "\n==============================================" << endl;
-        cout << "      学生管理菜单 (" << student->getID() << ")       " << endl;
-        cout << "==============================================" << endl;
-        cout << "1. 选修课程" << endl;
-        cout << "2. 退选课程" << endl;
-        cout << "3. 查询课程" << endl;
-        cout << "4. 查询答疑信息" << endl;
-        cout << "5. 修改密码" << endl;
-        cout << "6. 返回主菜单" << endl;
-        cout << "==============================================" << endl;
-        cout << "请选择: ";
-        
-        int choice;
-        cin >> choice;
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        
-        if (choice == 6) break;
-        
-        string cid, tid;
-        switch (choice) {
-            case 1: // 选修课程
-                system.displayAllCourses();
-                cout << "请输入要选修的课程ID: ";
-                getline(cin, cid);
-                student->selectCourse(cid);
-                break;
-                
-            case 2: // 退选课程
-                student->searchCourses();
-                cout << "请输入要退选的课程ID: ";
-                getline(cin, cid);
-                student->unselectCourse(cid);
-                break;
-                
-            case 3: // 查询课程
-                student->searchCourses();
-                break;
-                
-            case 4: // 查询答疑信息
-                student->searchCourses();
-                cout << "请输入课程ID: ";
-                getline(cin, cid);
-                cout << "请输入教师ID: ";
-                getline(cin, tid);
-                system.rateQA(student, tid, cid);
-                break;
-                
-            case 5: { // 修改密码
-                string newPwd;
-                cout << "请输入新密码: ";
-                getline(cin, newPwd);
-                student->setPassword(newPwd);
-                cout << "密码修改成功!" << endl;
-                break;
-            }
-   
-            default:
-                cout << "无效选择!" << endl;
-        }
-    }
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <cctype>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <queue>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <cerrno>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// 文件路径常量
+const string TEACHER_FILE = "teachers.dat";
+const string STUDENT_FILE = "students.dat";
+const string COURSE_FILE = "courses.dat";
+const string QA_FILE = "qa_records.dat";
+const string JOURNAL_FILE = "journal.log";
+
+// 日志累计到该条数时折叠回快照文件
+const size_t CHECKPOINT_RECORDS = 10000;
+// 后台检查点每持一次读锁最多格式化这么多字节, 期间前台修改需要等待
+const size_t CHECKPOINT_BATCH_BYTES = 32 * 1024;
+
+// 去掉行尾的'\r'(兼容CRLF格式的数据文件)
+void trimLineEnd(string& line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+}
+
+// 按分隔符切分一行
+vector<string> splitFields(const string& line, char delim) {
+    vector<string> fields;
+    stringstream ss(line);
+    string field;
+    while (getline(ss, field, delim)) {
+        fields.push_back(field);
+    }
+    if (!line.empty() && line.back() == delim) {
+        fields.push_back("");
+    }
+    return fields;
+}
+
+// 内存用量: QA_PROFILE下替换全局operator new, 统计累计的堆分配次数和字节数; 峰值RSS取自getrusage
+#ifdef QA_PROFILE
+atomic<uint64_t> heapAllocations(0);
+atomic<uint64_t> heapBytes(0);
+
+void* operator new(size_t n) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    heapBytes.fetch_add(n, memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+
+// 不内联, 以免编译器在调用处把new/free配对误报
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
+
+// 输出一行 "阶段,分配次数,分配字节数,峰值RSS(KB),当前RSS(KB)", 未启用QA_PROFILE时前两项为'-'
+void reportMemory(ostream& out, const char* stage) {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long pages = 0, residentPages = 0;
+    if (FILE* statm = fopen("/proc/self/statm", "r")) {
+        if (fscanf(statm, "%ld %ld", &pages, &residentPages) != 2) residentPages = 0;
+        fclose(statm);
+    }
+    out << stage << ",";
+#ifdef QA_PROFILE
+    out << heapAllocations.load(memory_order_relaxed) << "," << heapBytes.load(memory_order_relaxed);
+#else
+    out << "-,-";
+#endif
+    out << "," << usage.ru_maxrss << "," << residentPages * (sysconf(_SC_PAGESIZE) / 1024) << '\n';
+}
+
+// 运行统计: 编译时定义QA_PROFILE才启用(g++ -DQA_PROFILE), 否则下面的宏展开为空, 参数也不求值.
+// 每个线程把调用次数、读写字节数和耗时直方图记在自己的缓冲区里, 只有本线程写入,
+// 报告时加锁遍历所有线程的缓冲区汇总
+#ifdef QA_PROFILE
+enum ProfileOp { PROF_LOAD, PROF_SAVE, PROF_AUTH, PROF_ADD_QA, PROF_RATE_QA, PROF_SCAN, PROF_JOURNAL, PROF_OPS };
+const char* const PROFILE_NAMES[PROF_OPS] = {
+    "loadData", "saveData", "authenticate", "addQA", "rateQA", "scan", "journalCommit",
+};
+
+// HDR风格的对数-线性直方图(单位纳秒): 小于16的值各占一格, 其余按最高位分组, 组内按其后4位再分16格,
+// 相对误差不超过1/16
+struct LatencyHistogram {
+    static const int SUB_BITS = 4;
+    static const int BUCKETS = 64 << SUB_BITS;
+    
+    static int bucketOf(uint64_t v) {
+        if (v < (1u << SUB_BITS)) return static_cast<int>(v);
+        int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + static_cast<int>((v >> shift) & ((1 << SUB_BITS) - 1));
+    }
+    
+    // 格内的最大值
+    static uint64_t upperBound(int bucket) {
+        int group = bucket >> SUB_BITS;
+        uint64_t sub = bucket & ((1 << SUB_BITS) - 1);
+        if (group == 0) return sub;
+        return (((1u << SUB_BITS) + sub + 1) << (group - 1)) - 1;
+    }
+};
+
+// 单线程的统计缓冲区; 原子变量只是为了汇总时可以安全读取, 写入不需要读-改-写指令
+struct ProfileBuffer {
+    struct Slot {
+        atomic<uint64_t> calls;
+        atomic<uint64_t> bytesRead;
+        atomic<uint64_t> bytesWritten;
+        atomic<uint64_t> maxNs;
+        atomic<uint64_t> hist[LatencyHistogram::BUCKETS];
+    };
+    Slot slots[PROF_OPS];
+    
+    static void bump(atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(memory_order_relaxed) + n, memory_order_relaxed);
+    }
+};
+
+class Profiler {
+private:
+    mutex lock;
+    vector<unique_ptr<ProfileBuffer>> buffers; // 线程退出后缓冲区仍保留, 统计不丢
+
+public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+    
+    ProfileBuffer& local() {
+        thread_local ProfileBuffer* mine = nullptr;
+        if (!mine) {
+            lock_guard<mutex> guard(lock);
+            buffers.emplace_back(new ProfileBuffer());
+            mine = buffers.back().get();
+        }
+        return *mine;
+    }
+    
+    void record(ProfileOp op, uint64_t ns) {
+        ProfileBuffer::Slot& s = local().slots[op];
+        ProfileBuffer::bump(s.calls, 1);
+        ProfileBuffer::bump(s.hist[LatencyHistogram::bucketOf(ns)], 1);
+        if (ns > s.maxNs.load(memory_order_relaxed)) s.maxNs.store(ns, memory_order_relaxed);
+    }
+    
+    void addBytes(ProfileOp op, uint64_t read, uint64_t written) {
+        ProfileBuffer::Slot& s = local().slots[op];
+        ProfileBuffer::bump(s.bytesRead, read);
+        ProfileBuffer::bump(s.bytesWritten, written);
+    }
+    
+    // 汇总所有线程, 每种操作一行: 次数、读写字节、p50/p99/p999/最大耗时(微秒)
+    void report(ostream& out) {
+        lock_guard<mutex> guard(lock);
+        out << "operation,calls,bytes_read,bytes_written,p50_us,p99_us,p999_us,max_us" << '\n';
+        for (int op = 0; op < PROF_OPS; op++) {
+            uint64_t calls = 0, read = 0, written = 0, maxNs = 0;
+            vector<uint64_t> hist(LatencyHistogram::BUCKETS, 0);
+            for (const auto& b : buffers) {
+                const ProfileBuffer::Slot& s = b->slots[op];
+                calls += s.calls.load(memory_order_relaxed);
+                read += s.bytesRead.load(memory_order_relaxed);
+                written += s.bytesWritten.load(memory_order_relaxed);
+                maxNs = max<uint64_t>(maxNs, s.maxNs.load(memory_order_relaxed));
+                for (int k = 0; k < LatencyHistogram::BUCKETS; k++) {
+                    hist[k] += s.hist[k].load(memory_order_relaxed);
+                }
+            }
+            if (calls == 0 && read == 0 && written == 0) continue;
+            
+            auto percentile = [&](double q) {
+                uint64_t rank = static_cast<uint64_t>(ceil(q * calls)), seen = 0;
+                for (int k = 0; k < LatencyHistogram::BUCKETS; k++) {
+                    seen += hist[k];
+                    if (seen >= rank && seen > 0) return min(LatencyHistogram::upperBound(k), maxNs) / 1000.0;
+                }
+                return maxNs / 1000.0;
+            };
+            out << PROFILE_NAMES[op] << "," << calls << "," << read << "," << written << ","
+                << fixed << setprecision(1) << percentile(0.5) << "," << percentile(0.99) << ","
+                << percentile(0.999) << "," << maxNs / 1000.0 << '\n';
+        }
+        out << "memory,allocations,allocated_bytes,peak_rss_kb,rss_kb" << '\n';
+        reportMemory(out, "process");
+        out.flush();
+    }
+};
+
+// 作用域计时: 从构造到析构的耗时记入op
+class ProfileScope {
+private:
+    ProfileOp op;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit ProfileScope(ProfileOp o) : op(o), start(chrono::steady_clock::now()) {}
+    
+    ~ProfileScope() {
+        auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        Profiler::instance().record(op, static_cast<uint64_t>(ns));
+    }
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(op) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(op)
+#define PROFILE_BYTES(op, read, written) Profiler::instance().addBytes(op, read, written)
+#define PROFILE_REPORT(out) Profiler::instance().report(out)
+#else
+#define PROFILE_SCOPE(op)
+#define PROFILE_BYTES(op, read, written)
+#define PROFILE_REPORT(out) (out << "未启用运行统计, 编译时定义QA_PROFILE后可用" << '\n')
+#endif
+
+
+// 只读映射整个数据文件, 加载时直接在映射区上切分, 不逐行拷贝
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+    void* mapping;
+
+public:
+    explicit MappedFile(const string& path) : data(nullptr), length(0), mapping(nullptr) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+                mapping = p;
+                data = static_cast<const char*>(p);
+                length = st.st_size;
+            }
+        }
+        ::close(fd);
+    }
+    
+    ~MappedFile() {
+        if (mapping) ::munmap(mapping, length);
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    string_view view() const { return string_view(data, length); }
+    
+    // 前upto字节已解析完, 交还映射的页, 加载大文件时映射区不会整个留在内存里; 之后不能再访问这一段
+    void release(size_t upto) const {
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        upto = min(upto, length) / page * page;
+        if (mapping && upto > 0) ::madvise(mapping, upto, MADV_DONTNEED);
+    }
+};
+
+// 文件字节数, 文件不存在时返回-1
+int64_t fileSize(const string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? static_cast<int64_t>(st.st_size) : -1;
+}
+
+// 写满全部数据, 被信号打断时继续
+bool writeFully(int fd, string_view data) {
+    while (!data.empty()) {
+        ssize_t n = ::write(fd, data.data(), data.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(n);
+    }
+    return true;
+}
+
+// 文件内容落盘
+bool syncFile(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// 改名和新建的目录项要对所在目录(数据文件都在当前目录)fsync才算持久
+void syncDirectory() {
+    int fd = ::open(".", O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+}
+
+// 整个文件写到path并落盘(截断原有内容)
+bool writeFile(const string& path, string_view data) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeFully(fd, data) && ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// 从text中取下一行(去掉行尾\r\n), 取完返回false
+bool nextLine(string_view& text, string_view& line) {
+    if (text.empty()) return false;
+    const char* p = static_cast<const char*>(memchr(text.data(), '\n', text.size()));
+    size_t len = p ? p - text.data() : text.size();
+    line = text.substr(0, len);
+    text.remove_prefix(p ? len + 1 : len);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return true;
+}
+
+// 原地切分字段, 最后一个字段包含剩余全部内容; 返回字段数
+size_t splitView(string_view line, char delim, string_view* fields, size_t maxFields) {
+    size_t n = 0;
+    while (n + 1 < maxFields) {
+        size_t pos = line.find(delim);
+        if (pos == string_view::npos) break;
+        fields[n++] = line.substr(0, pos);
+        line.remove_prefix(pos + 1);
+    }
+    fields[n++] = line;
+    return n;
+}
+
+// 解析非负整数, 遇到非数字字符停止
+int parseInt(string_view text) {
+    int value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') break;
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+// 时间戳: 以1970-01-01 00:00起的秒数保存墙上时间(不做时区换算),
+// 文本格式仍为 "YYYY-MM-DD HH:MM"
+int64_t daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return static_cast<int64_t>(era) * 146097 + doe - 719468;
+}
+
+void civilFromDays(int64_t z, int& y, int& m, int& d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = static_cast<int>(z - era * 146097);
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int>(yoe + era * 400) + (m <= 2);
+}
+
+// 检查是否为 "YYYY-MM-DD HH:MM" 格式
+bool isTimeText(string_view text) {
+    if (text.size() != 16) return false;
+    for (size_t i = 0; i < text.size(); i++) {
+        char expect = i == 4 || i == 7 ? '-' : i == 10 ? ' ' : i == 13 ? ':' : '0';
+        if (expect == '0' ? (text[i] < '0' || text[i] > '9') : text[i] != expect) return false;
+    }
+    return true;
+}
+
+// 按固定位置解析 "YYYY-MM-DD HH:MM", 无法解析的时间记为0
+int64_t parseTime(string_view text) {
+    if (text.size() < 16 || text[4] != '-' || text[7] != '-' ||
+        text[10] != ' ' || text[13] != ':') {
+        return 0;
+    }
+    int y = parseInt(text.substr(0, 4));
+    int mo = parseInt(text.substr(5, 2));
+    int d = parseInt(text.substr(8, 2));
+    int h = parseInt(text.substr(11, 2));
+    int mi = parseInt(text.substr(14, 2));
+    return daysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60;
+}
+
+// 写入 "YYYY-MM-DD HH:MM" 到buf(至少TIME_TEXT_SIZE字节), 逐条保存时不产生临时字符串
+const size_t TIME_TEXT_SIZE = 32;
+
+void formatTime(int64_t ts, char* buf) {
+    int64_t days = ts >= 0 ? ts / 86400 : (ts - 86399) / 86400;
+    int secs = static_cast<int>(ts - days * 86400);
+    int y, mo, d;
+    civilFromDays(days, y, mo, d);
+    if (y < 0 || y > 9999) {
+        snprintf(buf, TIME_TEXT_SIZE, "%04d-%02d-%02d %02d:%02d", y, mo, d, secs / 3600, secs / 60 % 60);
+        return;
+    }
+    // 常见情况逐位写出, 批量保存时不走snprintf
+    auto put2 = [](char* p, int v) {
+        p[0] = static_cast<char>('0' + v / 10);
+        p[1] = static_cast<char>('0' + v % 10);
+    };
+    put2(buf, y / 100);
+    put2(buf + 2, y % 100);
+    buf[4] = '-';
+    put2(buf + 5, mo);
+    buf[7] = '-';
+    put2(buf + 8, d);
+    buf[10] = ' ';
+    put2(buf + 11, secs / 3600);
+    buf[13] = ':';
+    put2(buf + 14, secs / 60 % 60);
+    buf[16] = '\0';
+}
+
+string formatTime(int64_t ts) {
+    char buf[TIME_TEXT_SIZE];
+    formatTime(ts, buf);
+    return buf;
+}
+
+// 解析查询时间窗的端点: "YYYY-MM-DD" (当天0点) 或 "YYYY-MM-DD HH:MM"
+bool parseTimeBound(string_view text, int64_t& ts) {
+    string full(text);
+    if (full.size() == 10) full += " 00:00";
+    if (!isTimeText(full)) return false;
+    ts = parseTime(full);
+    return true;
+}
+
+// 写入OutputBuffer的定点小数(如 Decimal{7.25, 1} 输出 "7.3")和 "YYYY-MM-DD HH:MM" 时间
+struct Decimal {
+    double value;
+    int precision;
+};
+
+struct Timestamp {
+    int64_t ts;
+};
+
+// 输出缓冲: 格式化结果先写进缓冲区, 攒满64KB才整块交给下层流, 长列表不会逐行刷新;
+// 整数和小数用to_chars格式化, 不经过iostream的locale和格式状态.
+// 缓冲区在线程内复用, 析构时写出剩余内容. 用法与ostream相同: buf << "ID: " << id << '\n'
+class OutputBuffer {
+private:
+    static const size_t FLUSH_BYTES = 64 * 1024;
+    ostream& sink;
+    string buf;
+    uint64_t flushed = 0;
+    
+    static string& spare() {
+        static thread_local string storage;
+        return storage;
+    }
+    
+    void reserveTail(size_t n) {
+        if (buf.size() + n > buf.capacity()) buf.reserve(max(buf.capacity() * 2, buf.size() + n));
+    }
+    
+    void check() {
+        if (buf.size() >= FLUSH_BYTES) flush();
+    }
+
+public:
+    explicit OutputBuffer(ostream& out) : sink(out) {
+        buf.swap(spare());
+        buf.clear();
+        buf.reserve(FLUSH_BYTES + 256);
+    }
+    
+    ~OutputBuffer() {
+        flush();
+        if (spare().capacity() < buf.capacity()) spare().swap(buf);
+    }
+    
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    
+    void flush() {
+        if (buf.empty()) return;
+        sink.write(buf.data(), static_cast<streamsize>(buf.size()));
+        flushed += buf.size();
+        buf.clear();
+    }
+    
+    // 自构造以来写入的总字节数
+    uint64_t position() const { return flushed + buf.size(); }
+    // 尚未写出的字节数
+    size_t buffered() const { return buf.size(); }
+    
+    OutputBuffer& operator<<(string_view text) {
+        buf.append(text.data(), text.size());
+        check();
+        return *this;
+    }
+    
+    OutputBuffer& operator<<(const char* text) { return *this << string_view(text); }
+    OutputBuffer& operator<<(const string& text) { return *this << string_view(text); }
+    
+    OutputBuffer& operator<<(char c) {
+        buf.push_back(c);
+        check();
+        return *this;
+    }
+    
+    template <class T, class = enable_if_t<is_integral_v<T> && !is_same_v<T, char> && !is_same_v<T, bool>>>
+    OutputBuffer& operator<<(T value) {
+        char digits[24];
+        char* end = to_chars(digits, digits + sizeof(digits), value).ptr;
+        return *this << string_view(digits, end - digits);
+    }
+    
+    OutputBuffer& operator<<(Decimal d) {
+        char digits[64];
+        char* end = to_chars(digits, digits + sizeof(digits), d.value, chars_format::fixed, d.precision).ptr;
+        return *this << string_view(digits, end - digits);
+    }
+    
+    OutputBuffer& operator<<(Timestamp t) {
+        char text[TIME_TEXT_SIZE];
+        formatTime(t.ts, text);
+        return *this << string_view(text);
+    }
+};
+
+// 实体句柄: 教师/学生/课程ID在加载时驻留为稠密的32位整数,
+// 内存中的结构都以句柄为键, 只在显示和持久化时换回字符串
+typedef uint32_t Handle;
+const Handle NO_HANDLE = 0xFFFFFFFFu;
+
+// 单调内存区: 从64KB的块中顺序切分, 不单独释放, 随所有者整体析构.
+// 存放加载后不再修改的数据(ID字符串等), 省去每个小对象各自的一次堆分配
+class Arena {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    vector<unique_ptr<char[]>> blocks;
+    char* cur = nullptr;
+    size_t left = 0;
+
+public:
+    void* allocate(size_t n, size_t align = alignof(max_align_t)) {
+        size_t pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+        if (pad + n > left) {
+            size_t size = max(BLOCK_SIZE, n + align);
+            blocks.emplace_back(new char[size]);
+            cur = blocks.back().get();
+            left = size;
+            pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+        }
+        char* p = cur + pad;
+        cur = p + n;
+        left -= pad + n;
+        return p;
+    }
+    
+    string_view copy(string_view text) {
+        if (text.empty()) return string_view();
+        char* p = static_cast<char*>(allocate(text.size(), 1));
+        memcpy(p, text.data(), text.size());
+        return string_view(p, text.size());
+    }
+};
+
+// 定长节点池: 节点从Arena中切出, 释放后挂入空闲链表供下次分配复用.
+// 节点大小取第一次分配的大小, 其它大小的请求不由池提供
+class NodePool {
+private:
+    Arena arena;
+    size_t nodeSize = 0;
+    void* freeList = nullptr;
+
+public:
+    bool serves(size_t size) {
+        if (nodeSize == 0) nodeSize = max(size, sizeof(void*));
+        return size == nodeSize;
+    }
+    
+    void* allocate() {
+        if (!freeList) return arena.allocate(nodeSize);
+        void* p = freeList;
+        freeList = *static_cast<void**>(p);
+        return p;
+    }
+    
+    void release(void* p) {
+        *static_cast<void**>(p) = freeList;
+        freeList = p;
+    }
+};
+
+// 标准容器的分配器: 单个节点从共享的NodePool分配, 成批的(如哈希表的桶数组)仍走堆分配.
+// 池由分配器的各个副本共同持有, 容器移动或析构时不会悬空
+template <class T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+    shared_ptr<NodePool> pool;
+    
+    PoolAllocator() : pool(make_shared<NodePool>()) {}
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+    
+    T* allocate(size_t n) {
+        if (n == 1 && pool->serves(sizeof(T))) return static_cast<T*>(pool->allocate());
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    
+    void deallocate(T* p, size_t n) {
+        if (n == 1 && pool->serves(sizeof(T))) pool->release(p);
+        else ::operator delete(p);
+    }
+    
+    template <class U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+    template <class U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+};
+
+// 符号表: ID字符串与句柄的双向映射, 句柄按首次出现的顺序分配
+// 索引是开放寻址的线性探测表, 槽位里存哈希标签和句柄, 查找时基本只访问一次槽位和一次字符串.
+// 名称只增不删, 字符串本身存放在符号表自己的Arena里
+class SymbolTable {
+private:
+    Arena arena;
+    vector<string_view> names;
+    vector<uint64_t> slots; // 高32位: 哈希值高位, 低32位: 句柄+1, 0表示空槽
+    
+    static uint64_t hashOf(string_view name) {
+        return hash<string_view>()(name);
+    }
+    
+    // 返回name所在的槽位, 不存在时返回应插入的空槽
+    size_t probe(string_view name, uint64_t h) const {
+        size_t mask = slots.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(h >> 32);
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            uint64_t slot = slots[i];
+            if (slot == 0) return i;
+            if (static_cast<uint32_t>(slot >> 32) == tag &&
+                names[static_cast<uint32_t>(slot) - 1] == name) {
+                return i;
+            }
+        }
+    }
+    
+    void grow() {
+        vector<uint64_t> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, 0);
+        for (uint64_t slot : old) {
+            if (slot == 0) continue;
+            size_t mask = slots.size() - 1;
+            size_t i = hashOf(names[static_cast<uint32_t>(slot) - 1]) & mask;
+            while (slots[i] != 0) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+public:
+    Handle intern(string_view name) {
+        if ((names.size() + 1) * 2 > slots.size()) grow(); // 负载因子不超过1/2
+        uint64_t h = hashOf(name);
+        size_t i = probe(name, h);
+        if (slots[i] != 0) return static_cast<uint32_t>(slots[i]) - 1;
+        Handle handle = static_cast<Handle>(names.size());
+        names.push_back(arena.copy(name));
+        slots[i] = (h & 0xFFFFFFFF00000000ull) | (handle + 1);
+        return handle;
+    }
+    
+    // 未驻留过的ID返回NO_HANDLE
+    Handle find(string_view name) const {
+        if (slots.empty()) return NO_HANDLE;
+        size_t i = probe(name, hashOf(name));
+        return slots[i] != 0 ? static_cast<uint32_t>(slots[i]) - 1 : NO_HANDLE;
+    }
+    
+    string_view name(Handle h) const { return names[h]; }
+    size_t size() const { return names.size(); }
+};
+
+// 三类ID各用一张符号表, 保证各自的句柄都是稠密的
+struct Symbols {
+    SymbolTable teachers;
+    SymbolTable students;
+    SymbolTable courses;
+};
+
+// 课程类型. 新增类型: 加一个枚举值, 特化CourseTraits给出文件中的类型标记和显示名称,
+// 再把它加入下面的CourseKinds列表(按枚举值顺序)
+enum class CourseKind : uint8_t { Required, Elective };
+
+template <CourseKind K> struct CourseTraits;
+
+template <> struct CourseTraits<CourseKind::Required> {
+    static constexpr char TAG = 'B';
+    static constexpr const char* NAME = "必修";
+};
+
+template <> struct CourseTraits<CourseKind::Elective> {
+    static constexpr char TAG = 'X';
+    static constexpr const char* NAME = "选修";
+};
+
+// 编译期类型表: 由CourseTraits展开成以枚举值为下标的常量数组, 按类型取标记和名称只是一次查表
+template <CourseKind... Ks>
+struct CourseKindRegistry {
+    struct Info {
+        char tag;
+        const char* name;
+    };
+    static constexpr Info info[] = {{CourseTraits<Ks>::TAG, CourseTraits<Ks>::NAME}...};
+    static constexpr size_t COUNT = sizeof...(Ks);
+    
+    static constexpr bool indexedByKind() {
+        size_t i = 0;
+        bool ok = true;
+        ((ok = ok && static_cast<size_t>(Ks) == i++), ...);
+        return ok;
+    }
+    static_assert(indexedByKind(), "CourseKinds必须按枚举值顺序列出");
+    
+    static char tagOf(CourseKind k) { return info[static_cast<size_t>(k)].tag; }
+    static const char* nameOf(CourseKind k) { return info[static_cast<size_t>(k)].name; }
+    
+    // 按类型标记或显示名称查找, 未知时返回false
+    static bool fromTag(char tag, CourseKind& kind) {
+        for (size_t i = 0; i < COUNT; i++) {
+            if (info[i].tag == tag) {
+                kind = static_cast<CourseKind>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    static bool fromName(string_view name, CourseKind& kind) {
+        for (size_t i = 0; i < COUNT; i++) {
+            if (name == info[i].name) {
+                kind = static_cast<CourseKind>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+typedef CourseKindRegistry<CourseKind::Required, CourseKind::Elective> CourseKinds;
+
+// 课程: 值类型, 类型由kind区分, 没有虚函数, 在课程表中连续存放
+class Course {
+private:
+    string courseID;
+    string courseName;
+    string qaTime;
+    CourseKind kind = CourseKind::Required;
+
+public:
+    Course() {}
+    Course(string id, string name, string time, CourseKind k)
+        : courseID(id), courseName(name), qaTime(time), kind(k) {}
+    
+    const string& getCourseID() const { return courseID; }
+    const string& getCourseName() const { return courseName; }
+    const string& getQATime() const { return qaTime; }
+    CourseKind getKind() const { return kind; }
+    const char* getType() const { return CourseKinds::nameOf(kind); }
+    char getTypeTag() const { return CourseKinds::tagOf(kind); } // 文件中的类型标记
+    
+    void showMe(OutputBuffer& out) const {
+        out << "课程ID: " << courseID 
+            << ", 名称: " << courseName
+            << ", 类型: " << getType()
+            << ", 答疑时间: " << qaTime << '\n';
+    }
+    
+    // 文件操作
+    void saveToFile(OutputBuffer& out) const {
+        out << courseID << '|' << courseName << '|' << qaTime << '|' << getTypeTag() << '\n';
+    }
+    
+    // 读取一行 "ID|名称|答疑时间|类型", 类型标记未知时返回false
+    bool loadFromLine(string_view line) {
+        string_view f[4];
+        splitView(line, '|', f, 4);
+        if (line.empty() || !CourseKinds::fromTag(line.back(), kind)) return false;
+        courseID.assign(f[0]);
+        courseName.assign(f[1]);
+        qaTime.assign(f[2]);
+        return true;
+    }
+};
+
+// 答疑信息结构, 用于读写和显示单条记录; 内存中按列存放在QAStore
+struct QAInfo {
+    Handle teacher;
+    Handle student;
+    Handle course;
+    int64_t time;
+    int rating;
+    
+    QAInfo(Handle tid, Handle sid, Handle cid, int64_t t, int r)
+        : teacher(tid), student(sid), course(cid), time(t), rating(r) {}
+    
+    // 未评分写成两位的"00", 之后评分时可在文件中原位改写为"07"或"10"(读取时与"7"等价)
+    void saveToFile(OutputBuffer& out, const Symbols& ids) const {
+        out << ids.teachers.name(teacher) << '|' << ids.students.name(student) << '|'
+            << ids.courses.name(course) << '|' << Timestamp{time} << '|';
+        if (rating == 0) out << "00";
+        else out << rating;
+        out << '\n';
+    }
+    
+    // 切分一行 "教师|学生|课程|时间|评分", 格式错误(缺字段、ID为空、时间或评分非法)时返回false
+    static bool splitLine(string_view line, string_view (&f)[5]) {
+        return splitView(line, '|', f, 5) == 5 && !f[0].empty() && !f[1].empty() && !f[2].empty() &&
+               isTimeText(f[3]) && !f[4].empty() && f[4].size() <= 2 &&
+               f[4].find_first_not_of("0123456789") == string_view::npos && parseInt(f[4]) <= 10;
+    }
+    
+    bool loadFromLine(string_view line, Symbols& ids) {
+        string_view f[5];
+        if (!splitLine(line, f)) return false;
+        teacher = ids.teachers.intern(f[0]);
+        student = ids.students.intern(f[1]);
+        course = ids.courses.intern(f[2]);
+        time = parseTime(f[3]);
+        rating = parseInt(f[4]);
+        return true;
+    }
+    
+    // 同上, 但只查找已驻留的ID(重新读入换出的记录页), 有不认识的ID时返回false
+    bool findFromLine(string_view line, const Symbols& ids) {
+        string_view f[5];
+        if (!splitLine(line, f)) return false;
+        teacher = ids.teachers.find(f[0]);
+        student = ids.students.find(f[1]);
+        course = ids.courses.find(f[2]);
+        time = parseTime(f[3]);
+        rating = parseInt(f[4]);
+        return teacher != NO_HANDLE && student != NO_HANDLE && course != NO_HANDLE;
+    }
+    
+    void display(const Symbols& ids, OutputBuffer& out) const {
+        out << "教师: " << ids.teachers.name(teacher) << ", 学生: " << ids.students.name(student) 
+            << ", 课程: " << ids.courses.name(course) << ", 时间: " << Timestamp{time}
+            << ", 评分: " << rating << "/10" << '\n';
+    }
+};
+
+// 评分统计: 1-10分的直方图, 计数/总分/最高/最低都由直方图推出
+struct RatingStats {
+    uint64_t hist[11];
+    
+    RatingStats() { fill(hist, hist + 11, 0); }
+    
+    uint64_t count() const {
+        uint64_t n = 0;
+        for (int v = 1; v <= 10; v++) n += hist[v];
+        return n;
+    }
+    
+    uint64_t sum() const {
+        uint64_t s = 0;
+        for (int v = 1; v <= 10; v++) s += hist[v] * v;
+        return s;
+    }
+    
+    int max() const {
+        for (int v = 10; v >= 1; v--) if (hist[v]) return v;
+        return 0;
+    }
+    
+    int min() const {
+        for (int v = 1; v <= 10; v++) if (hist[v]) return v;
+        return 0;
+    }
+    
+    double average() const {
+        uint64_t n = count();
+        return n ? static_cast<double>(sum()) / n : 0.0;
+    }
+};
+
+// 统计前n条记录中keys[i] == key(key为NO_HANDLE时不过滤)的评分直方图, 未评分(0分)不计入
+// SSE2下每次处理16条: 4次32位比较压成16字节掩码, 再逐个分值做字节比较计数
+void rateHistogram(const Handle* keys, const uint8_t* ratings, size_t n, Handle key, RatingStats& out) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i want = _mm_set1_epi32(static_cast<int>(key));
+    const __m128i all = _mm_set1_epi8(-1);
+    __m128i value[11];
+    for (int v = 1; v <= 10; v++) value[v] = _mm_set1_epi8(static_cast<char>(v));
+    
+    while (n - i >= 16) {
+        // 8位计数器每255轮归并一次, 防止溢出
+        __m128i acc[11];
+        for (int v = 1; v <= 10; v++) acc[v] = zero;
+        size_t rounds = min<size_t>((n - i) / 16, 255);
+        for (size_t r = 0; r < rounds; r++, i += 16) {
+            __m128i mask = all;
+            if (keys) {
+                const __m128i* k = reinterpret_cast<const __m128i*>(keys + i);
+                __m128i m0 = _mm_cmpeq_epi32(_mm_loadu_si128(k), want);
+                __m128i m1 = _mm_cmpeq_epi32(_mm_loadu_si128(k + 1), want);
+                __m128i m2 = _mm_cmpeq_epi32(_mm_loadu_si128(k + 2), want);
+                __m128i m3 = _mm_cmpeq_epi32(_mm_loadu_si128(k + 3), want);
+                mask = _mm_packs_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3));
+            }
+            __m128i rv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ratings + i));
+            for (int v = 1; v <= 10; v++) {
+                acc[v] = _mm_sub_epi8(acc[v], _mm_and_si128(mask, _mm_cmpeq_epi8(rv, value[v])));
+            }
+        }
+        for (int v = 1; v <= 10; v++) {
+            __m128i s = _mm_sad_epu8(acc[v], zero);
+            out.hist[v] += static_cast<uint64_t>(_mm_cvtsi128_si32(s)) +
+                           static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(s, 8)));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (keys && keys[i] != key) continue;
+        uint8_t r = ratings[i];
+        if (r >= 1 && r <= 10) out.hist[r]++;
+    }
+}
+
+// 答疑记录的组合键(学生, 教师, 课程)
+struct QAKey {
+    Handle student;
+    Handle teacher;
+    Handle course;
+    
+    bool operator==(const QAKey& other) const {
+        return student == other.student &&
+               teacher == other.teacher &&
+               course == other.course;
+    }
+};
+
+struct QAKeyHash {
+    size_t operator()(const QAKey& k) const {
+        uint64_t h = (static_cast<uint64_t>(k.student) << 32) | k.teacher;
+        h ^= static_cast<uint64_t>(k.course) * 0x9E3779B97F4A7C15ull;
+        return hash<uint64_t>()(h);
+    }
+};
+
+// 句柄的有序集合(教师/学生的课程, 课程的选课名单, 答疑记录出现过的页): 不超过INLINE个元素时存放在对象内部,
+// 不单独分配内存, 超过后转到堆上按倍数扩容. 成员判断为二分查找, 按升序追加为O(1)
+class HandleSet {
+private:
+    static const uint32_t INLINE = 6;
+    uint32_t count;
+    uint32_t capacity;
+    union {
+        Handle local[INLINE];
+        Handle* heap;
+    };
+    
+    Handle* data() { return capacity > INLINE ? heap : local; }
+    const Handle* data() const { return capacity > INLINE ? heap : local; }
+    
+    void release() {
+        if (capacity > INLINE) delete[] heap;
+        capacity = INLINE;
+    }
+    
+    void reserve(uint32_t need) {
+        if (need <= capacity) return;
+        uint32_t cap = max(need, capacity * 2);
+        Handle* p = new Handle[cap];
+        memcpy(p, data(), count * sizeof(Handle));
+        release();
+        heap = p;
+        capacity = cap;
+    }
+    
+    void take(HandleSet& other) {
+        count = other.count;
+        capacity = other.capacity;
+        if (capacity > INLINE) heap = other.heap;
+        else memcpy(local, other.local, count * sizeof(Handle));
+        other.count = 0;
+        other.capacity = INLINE;
+    }
+
+public:
+    HandleSet() : count(0), capacity(INLINE) {}
+    
+    HandleSet(const HandleSet& other) : count(0), capacity(INLINE) {
+        *this = other;
+    }
+    
+    HandleSet(HandleSet&& other) noexcept {
+        take(other);
+    }
+    
+    HandleSet& operator=(const HandleSet& other) {
+        if (this != &other) {
+            count = 0;
+            reserve(other.count);
+            memcpy(data(), other.data(), other.count * sizeof(Handle));
+            count = other.count;
+        }
+        return *this;
+    }
+    
+    HandleSet& operator=(HandleSet&& other) noexcept {
+        if (this != &other) {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+    
+    ~HandleSet() { release(); }
+    
+    const Handle* begin() const { return data(); }
+    const Handle* end() const { return data() + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    
+    bool contains(Handle h) const {
+        return binary_search(begin(), end(), h);
+    }
+    
+    // 返回是否新加入
+    bool insert(Handle h) {
+        Handle* p = data();
+        Handle* pos = count == 0 || p[count - 1] < h ? p + count : lower_bound(p, p + count, h);
+        if (pos != p + count && *pos == h) return false;
+        size_t at = pos - p;
+        reserve(count + 1);
+        p = data();
+        memmove(p + at + 1, p + at, (count - at) * sizeof(Handle));
+        p[at] = h;
+        count++;
+        return true;
+    }
+    
+    bool erase(Handle h) {
+        Handle* p = data();
+        Handle* pos = lower_bound(p, p + count, h);
+        if (pos == p + count || *pos != h) return false;
+        memmove(pos, pos + 1, (p + count - pos - 1) * sizeof(Handle));
+        count--;
+        return true;
+    }
+    
+    // 并入升序无重复的[first, last)(可与已有元素重复), 从尾部向前一趟归并; 返回新加入的个数
+    size_t merge(const Handle* first, const Handle* last) {
+        uint32_t added = 0;
+        const Handle* a = data();
+        const Handle* aEnd = a + count;
+        for (const Handle* b = first; b != last;) {
+            if (a == aEnd || *b < *a) {
+                added++;
+                b++;
+            } else if (*a < *b) {
+                a++;
+            } else {
+                a++;
+                b++;
+            }
+        }
+        if (added == 0) return 0;
+        reserve(count + added);
+        Handle* p = data();
+        Handle* out = p + count + added;
+        Handle* rest = p + count;
+        for (const Handle* b = last; b != first;) {
+            if (rest != p && *(rest - 1) >= *(b - 1)) {
+                if (*(rest - 1) == *(b - 1)) b--;
+                *--out = *--rest;
+            } else {
+                *--out = *--b;
+            }
+        }
+        count += added;
+        return added;
+    }
+    
+    // 整体替换, list可以无序、有重复
+    void assign(vector<Handle> list) {
+        sort(list.begin(), list.end());
+        list.erase(unique(list.begin(), list.end()), list.end());
+        count = 0;
+        reserve(static_cast<uint32_t>(list.size()));
+        memcpy(data(), list.data(), list.size() * sizeof(Handle));
+        count = static_cast<uint32_t>(list.size());
+    }
+    
+    // 句柄换算后重新排序(换算是一一对应的, 不会产生重复)
+    void remap(const vector<Handle>& map) {
+        Handle* p = data();
+        for (uint32_t i = 0; i < count; i++) p[i] = map[p[i]];
+        sort(p, p + count);
+    }
+};
+
+// 每页存放的答疑记录条数, 取16的倍数, SIMD按16条一组扫描时页内没有尾巴
+const size_t QA_CHUNK_ROWS = 1 << 12;
+// 默认最多在内存中保留的答疑记录条数, 按整页计
+const size_t QA_RESIDENT_RECORDS = 1 << 20;
+
+// 答疑记录页的数据: 页内按列存放(教师/学生/课程句柄、时间戳、评分各一列)
+struct QAChunk {
+    Handle teacher[QA_CHUNK_ROWS];
+    Handle student[QA_CHUNK_ROWS];
+    Handle course[QA_CHUNK_ROWS];
+    int64_t time[QA_CHUNK_ROWS];
+    uint8_t rating[QA_CHUNK_ROWS];
+};
+
+// 换出的答疑记录页读不回来(答疑文件被外部改动或读出错)时由QAStore抛出, 不返回缺行的页;
+// 查询命令提示后作废本次结果, 检查点作废本次写出
+class PageReadError : public runtime_error {
+public:
+    explicit PageReadError(const string& what) : runtime_error(what) {}
+};
+
+// 答疑记录存储: 记录下标即添加顺序, 按下标分页存放, 追加只写最后一页.
+// 页的数据按需从答疑文件读入, 内存中的页超过上限时换出最久未用的; 整页都已写入文件且此后没有修改的页
+// 才能换出(按最近使用排成链表), 其余的常驻. 常驻内存的只有索引: 每页的时间范围和文件位置, 每位教师/学生/每门课程
+// 出现过的页, 评分统计和未评分队列
+class QAStore {
+public:
+    static constexpr uint32_t NO_RECORD = 0xFFFFFFFFu;
+    enum Filter { ALL, BY_TEACHER, BY_STUDENT, BY_COURSE };
+    
+private:
+    static constexpr uint32_t NO_PAGE = 0xFFFFFFFFu;
+    
+    // 页的摘要常驻内存: 时间的最小/最大值以及时间是否按行非递减, 时间窗查询据此跳过整页或在页内二分
+    struct Page {
+        mutable shared_ptr<QAChunk> data; // 不在内存时为空
+        // 可换出时在换出链表中的前后两页
+        mutable bool listed = false;
+        mutable uint32_t prev = NO_PAGE;
+        mutable uint32_t next = NO_PAGE;
+        int64_t minTime = 0;
+        int64_t maxTime = 0;
+        bool ordered = true;
+        bool located = false;  // 首行已写入答疑文件, 偏移为begin
+        bool inFile = false;   // 整页都在答疑文件的[begin, end)中
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        uint64_t modified = 0; // 最后一次添加或评分时的版本号
+        // 本页中在未评分队列里还有后继的行: 高32位为页内行号, 低32位为后继的下标; 追加时乱序的
+        // 在评分查找前才排序
+        vector<uint64_t> successors;
+        bool successorsSorted = true;
+    };
+    
+    // 已提交的答疑文件; 读入页时持有一份引用, 换成新文件后旧文件在读完后才关闭
+    struct PageFile {
+        int fd;
+        explicit PageFile(const string& path) : fd(open(path.c_str(), O_RDONLY)) {}
+        ~PageFile() {
+            if (fd >= 0) close(fd);
+        }
+    };
+    
+    // 某位教师/学生/某门课程的记录条数和出现过的页(升序); 记录按页的顺序添加, 最后一页另存一份,
+    // 同一页的后续记录不必访问页表
+    struct Posting {
+        HandleSet pages;
+        uint32_t size = 0;
+        uint32_t last = NO_RECORD;
+    };
+    
+    const Symbols& names; // 读入页时按ID查句柄, 调用方持有符号表的读锁
+    vector<Page> pages;
+    size_t rows = 0;
+    size_t residentLimit;      // 内存中页数的上限, 不能换出的页不受限制
+    mutable size_t resident = 0;
+    // 换出链表: 在内存中、整页在文件里且此后没有修改的页, 表头最近用过, 换出时取表尾
+    mutable uint32_t lruHead = NO_PAGE;
+    mutable uint32_t lruTail = NO_PAGE;
+    // 持读锁的查询和检查点线程会并发读入和换出页, 由它保护上面几项、file、fileVersion
+    // 以及各页的data/modified、链表指针和文件位置
+    mutable mutex pagesLock;
+    shared_ptr<PageFile> file;
+    shared_ptr<PageFile> retired; // 被替换的旧文件, 由closeRetired()在锁外关闭
+    uint64_t version = 0;
+    uint64_t fileVersion = 0;  // 版本号不超过它的修改都已写入答疑文件
+    
+    // 每个组合键下未评分记录组成的队列(头, 尾), 队列中后面还有记录的行在所在页的successors中记下后继;
+    // 评分出队、添加入队频繁, 节点由池分配复用
+    unordered_map<QAKey, pair<uint32_t, uint32_t>, QAKeyHash, equal_to<QAKey>,
+                  PoolAllocator<pair<const QAKey, pair<uint32_t, uint32_t>>>> unrated;
+    vector<Posting> byTeacher;  // 以教师句柄为下标
+    vector<Posting> byStudent;  // 以学生句柄为下标
+    vector<Posting> byCourse;   // 以课程句柄为下标
+    // 每位教师、每门课程的评分直方图(hist[0]为未评分条数), 随记录添加和评分增量维护
+    vector<RatingStats> teacherAgg;
+    vector<RatingStats> courseAgg;
+    // 脏记录: 已写入快照的行数, 以及其中此后被评分的行(增量保存时原位改写评分)
+    size_t persistedRows = 0;
+    vector<uint32_t> reratedRows;
+    // 从文本文件加载时上一条记录的结束位置, 以及当前页的各行在文件中是否首尾相接
+    uint64_t loadEnd = 0;
+    bool loadContiguous = false;
+    
+    // 页直接向系统申请, 换出时立即归还, 不在堆里留下空洞
+    static shared_ptr<QAChunk> newChunk() {
+        void* p = mmap(nullptr, sizeof(QAChunk), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw bad_alloc();
+        return shared_ptr<QAChunk>(static_cast<QAChunk*>(p), [](QAChunk* c) { munmap(c, sizeof(QAChunk)); });
+    }
+    
+    size_t rowsIn(size_t p) const { return min(QA_CHUNK_ROWS, rows - p * QA_CHUNK_ROWS); }
+    
+    // 从答疑文件的[begin, end)读入换出的第p页(总是整页); 读不全或有行解析不了(文件被外部改动)时返回空
+    shared_ptr<QAChunk> readPage(const PageFile& source, uint64_t begin, uint64_t end) const {
+        shared_ptr<QAChunk> c = newChunk();
+        string text(end - begin, '\0');
+        ssize_t got = pread(source.fd, &text[0], text.size(), begin);
+        if (got != static_cast<ssize_t>(text.size())) return nullptr;
+        string_view rest(text), line;
+        size_t r = 0;
+        while (r < QA_CHUNK_ROWS && nextLine(rest, line)) {
+            if (line.empty()) continue;
+            QAInfo qa(NO_HANDLE, NO_HANDLE, NO_HANDLE, 0, 0);
+            if (!qa.findFromLine(line, names)) break;
+            c->teacher[r] = qa.teacher;
+            c->student[r] = qa.student;
+            c->course[r] = qa.course;
+            c->time[r] = qa.time;
+            c->rating[r] = static_cast<uint8_t>(qa.rating);
+            r++;
+        }
+        return r == QA_CHUNK_ROWS ? c : nullptr;
+    }
+    
+    // 以下几个函数维护换出链表, 调用方持有pagesLock
+    bool evictable(const Page& page) const {
+        return page.data && page.inFile && page.modified <= fileVersion;
+    }
+    
+    void unlist(size_t p) const {
+        const Page& page = pages[p];
+        if (!page.listed) return;
+        (page.prev == NO_PAGE ? lruHead : pages[page.prev].next) = page.next;
+        (page.next == NO_PAGE ? lruTail : pages[page.next].prev) = page.prev;
+        page.listed = false;
+    }
+    
+    // 用到第p页, 或它刚变为可换出: 移到表头; 不能换出的页不在表中
+    void touch(size_t p) const {
+        unlist(p);
+        const Page& page = pages[p];
+        if (!evictable(page)) return;
+        page.listed = true;
+        page.prev = NO_PAGE;
+        page.next = lruHead;
+        (lruHead == NO_PAGE ? lruTail : pages[lruHead].prev) = static_cast<uint32_t>(p);
+        lruHead = static_cast<uint32_t>(p);
+    }
+    
+    // 文件整体换掉, 所有页都不在文件中
+    void clearList() const {
+        for (const Page& page : pages) page.listed = false;
+        lruHead = lruTail = NO_PAGE;
+    }
+    
+    // 从表尾换出最久未用的页直到不超过上限, 表头(刚用过的)一页不换出
+    void evict() const {
+        while (resident > residentLimit && lruTail != lruHead) {
+            size_t victim = lruTail;
+            unlist(victim);
+            pages[victim].data.reset();
+            resident--;
+        }
+    }
+    
+    // 取第p页的数据, 不在内存时读入, 解析期间不持pagesLock; 两个线程同时读入同一页时用先放进去的.
+    // 返回的指针在使用期间保证页不被释放. 读入失败时页仍留在文件中, 抛出PageReadError
+    shared_ptr<QAChunk> load(size_t p) const {
+        unique_lock<mutex> guard(pagesLock);
+        if (pages[p].data) {
+            touch(p);
+            return pages[p].data;
+        }
+        shared_ptr<PageFile> source = file;
+        uint64_t begin = pages[p].begin, end = pages[p].end;
+        guard.unlock();
+        shared_ptr<QAChunk> c = readPage(*source, begin, end);
+        if (!c) {
+            throw PageReadError(QA_FILE + ": 读入第 " + to_string(p * QA_CHUNK_ROWS + 1) +
+                                " 条起的答疑记录失败, 文件可能已被改动");
+        }
+        guard.lock();
+        const Page& page = pages[p];
+        if (!page.data) {
+            page.data = move(c);
+            resident++;
+        }
+        touch(p);
+        evict();
+        return page.data;
+    }
+    
+    // 修改第idx行所在的页, 修改过的页在写入文件之前不会换出. 调用方持有写锁
+    QAChunk& modify(size_t idx) {
+        size_t p = idx / QA_CHUNK_ROWS;
+        {
+            lock_guard<mutex> guard(pagesLock);
+            pages[p].modified = ++version;
+            unlist(p);
+        }
+        return *load(p);
+    }
+    
+    static void post(vector<Posting>& index, Handle h, size_t p) {
+        if (h >= index.size()) index.resize(h + 1);
+        Posting& posting = index[h];
+        if (posting.last != p) {
+            posting.pages.insert(static_cast<Handle>(p));
+            posting.last = static_cast<uint32_t>(p);
+        }
+        posting.size++;
+    }
+    
+    // filter不为ALL时key出现过的页, 为ALL时返回nullptr表示全部页
+    const HandleSet* pagesOf(Filter filter, Handle key) const {
+        static const HandleSet none;
+        if (filter == BY_TEACHER) return key < byTeacher.size() ? &byTeacher[key].pages : &none;
+        if (filter == BY_STUDENT) return key < byStudent.size() ? &byStudent[key].pages : &none;
+        if (filter == BY_COURSE) return key < byCourse.size() ? &byCourse[key].pages : &none;
+        return nullptr;
+    }
+    
+    // 按添加顺序访问column列等于h的记录下标, visit返回false时停止
+    template <class F>
+    void walk(Filter filter, const Handle (QAChunk::*column)[QA_CHUNK_ROWS], Handle h, F visit) const {
+        for (Handle p : *pagesOf(filter, h)) {
+            shared_ptr<QAChunk> c = load(p);
+            const Handle* keys = (*c).*column;
+            for (size_t r = 0, n = rowsIn(p); r < n; r++) {
+                if (keys[r] == h && !visit(p * QA_CHUNK_ROWS + r)) return;
+            }
+        }
+    }
+    
+    static const RatingStats& aggregate(const vector<RatingStats>& aggs, Handle h) {
+        static const RatingStats none;
+        return h < aggs.size() ? aggs[h] : none;
+    }
+    
+    static void count(vector<RatingStats>& aggs, Handle h, uint8_t rating) {
+        if (rating > 10) return;
+        if (h >= aggs.size()) aggs.resize(h + 1);
+        aggs[h].hist[rating]++;
+    }
+    
+    // 追加一段空行, 返回第一行的下标; 新页由调用方写满各列
+    size_t grow(size_t n) {
+        size_t first = rows;
+        rows += n;
+        lock_guard<mutex> guard(pagesLock);
+        while (pages.size() * QA_CHUNK_ROWS < rows) {
+            pages.emplace_back();
+            pages.back().data = newChunk();
+            resident++;
+        }
+        return first;
+    }
+    
+    void indexRow(size_t idx, const QAChunk& c) {
+        size_t p = idx / QA_CHUNK_ROWS;
+        size_t r = idx % QA_CHUNK_ROWS;
+        Page& page = pages[p];
+        int64_t t = c.time[r];
+        if (r == 0) {
+            page.minTime = page.maxTime = t;
+            page.ordered = true;
+        } else {
+            page.ordered = page.ordered && t >= c.time[r - 1];
+            page.minTime = min(page.minTime, t);
+            page.maxTime = max(page.maxTime, t);
+        }
+        post(byTeacher, c.teacher[r], p);
+        post(byStudent, c.student[r], p);
+        post(byCourse, c.course[r], p);
+        count(teacherAgg, c.teacher[r], c.rating[r]);
+        count(courseAgg, c.course[r], c.rating[r]);
+        if (c.rating[r] == 0) {
+            auto it = unrated.emplace(QAKey{c.student[r], c.teacher[r], c.course[r]},
+                                      make_pair(NO_RECORD, NO_RECORD)).first;
+            uint32_t id = static_cast<uint32_t>(idx);
+            if (it->second.first == NO_RECORD) it->second.first = id;
+            else link(it->second.second, id);
+            it->second.second = id;
+        }
+    }
+    
+    // 记下未评分行tail在队列中的后继next
+    void link(uint32_t tail, uint32_t next) {
+        Page& page = pages[tail / QA_CHUNK_ROWS];
+        uint64_t entry = static_cast<uint64_t>(tail % QA_CHUNK_ROWS) << 32 | next;
+        if (!page.successors.empty() && page.successors.back() > entry) page.successorsSorted = false;
+        page.successors.push_back(entry);
+    }
+    
+    // 取出行head的后继, 没有时返回NO_RECORD
+    uint32_t unlink(uint32_t head) {
+        Page& page = pages[head / QA_CHUNK_ROWS];
+        if (!page.successorsSorted) {
+            sort(page.successors.begin(), page.successors.end());
+            page.successorsSorted = true;
+        }
+        uint64_t row = static_cast<uint64_t>(head % QA_CHUNK_ROWS) << 32;
+        auto it = lower_bound(page.successors.begin(), page.successors.end(), row);
+        if (it == page.successors.end() || (*it >> 32) != (row >> 32)) return NO_RECORD;
+        uint32_t next = static_cast<uint32_t>(*it);
+        page.successors.erase(it);
+        return next;
+    }
+    
+public:
+    QAStore(const Symbols& ids, size_t residentRecords)
+        : names(ids), residentLimit(max<size_t>(1, (residentRecords + QA_CHUNK_ROWS - 1) / QA_CHUNK_ROWS)) {}
+    
+    size_t add(const QAInfo& qa) {
+        size_t idx = grow(1);
+        QAChunk& c = modify(idx);
+        size_t r = idx % QA_CHUNK_ROWS;
+        c.teacher[r] = qa.teacher;
+        c.student[r] = qa.student;
+        c.course[r] = qa.course;
+        c.time[r] = qa.time;
+        c.rating[r] = static_cast<uint8_t>(qa.rating);
+        indexRow(idx, c);
+        return idx;
+    }
+    
+    // 从文本文件加载之前打开该文件, 加载中写满的页可以立即换出
+    void openFile(const string& path) {
+        auto opened = make_shared<PageFile>(path);
+        lock_guard<mutex> guard(pagesLock);
+        if (opened->fd < 0) return;
+        retired = move(file);
+        file = opened;
+        for (Page& page : pages) page.located = page.inFile = false;
+        clearList();
+    }
+    
+    // 加载openFile()打开的文件中[begin, end)处的一条记录, 与文件一致, 不算修改.
+    // 页写满且各行在文件中首尾相接(中间没有跳过的行)时记下位置, 超出上限的页随即换出
+    size_t addFromFile(const QAInfo& qa, uint64_t begin, uint64_t end) {
+        // 只在开新页和写满时取pagesLock; 没写满的页不会换出, 数据直接写入
+        size_t idx = rows % QA_CHUNK_ROWS == 0 ? grow(1) : rows++;
+        size_t p = idx / QA_CHUNK_ROWS;
+        size_t r = idx % QA_CHUNK_ROWS;
+        Page& page = pages[p];
+        if (r == 0) {
+            lock_guard<mutex> guard(pagesLock);
+            page.begin = begin;
+            page.located = file != nullptr;
+        }
+        QAChunk& c = *page.data;
+        c.teacher[r] = qa.teacher;
+        c.student[r] = qa.student;
+        c.course[r] = qa.course;
+        c.time[r] = qa.time;
+        c.rating[r] = static_cast<uint8_t>(qa.rating);
+        indexRow(idx, c);
+        loadContiguous = r == 0 || (loadContiguous && begin == loadEnd);
+        loadEnd = end;
+        if (r + 1 == QA_CHUNK_ROWS && loadContiguous) {
+            lock_guard<mutex> guard(pagesLock);
+            if (page.located) {
+                page.end = end;
+                page.inFile = true;
+                touch(p);
+                evict();
+            }
+        }
+        return idx;
+    }
+    
+    // 整列追加(二进制快照加载), 按页拷贝后逐行建立索引
+    void appendColumns(const Handle* teacher, const Handle* student, const Handle* course,
+                       const int64_t* time, const uint8_t* rating, size_t n) {
+        size_t first = grow(n);
+        for (size_t done = 0; done < n; ) {
+            size_t idx = first + done;
+            size_t r = idx % QA_CHUNK_ROWS;
+            size_t k = min(n - done, QA_CHUNK_ROWS - r);
+            QAChunk& c = modify(idx);
+            memcpy(c.teacher + r, teacher + done, k * sizeof(Handle));
+            memcpy(c.student + r, student + done, k * sizeof(Handle));
+            memcpy(c.course + r, course + done, k * sizeof(Handle));
+            memcpy(c.time + r, time + done, k * sizeof(int64_t));
+            memcpy(c.rating + r, rating + done, k);
+            for (size_t i = idx; i < idx + k; i++) {
+                indexRow(i, c);
+            }
+            done += k;
+        }
+    }
+    
+    // 答疑文件已提交: 共fileRows行、bytes字节, starts[k]为第firstPage+k页首行的偏移;
+    // replaced为true时文件已整体替换, 重新打开, 原来的位置全部作废. 版本号不超过written的修改都已在文件中.
+    // 调用方持有写锁
+    void fileCommitted(const string& path, bool replaced, size_t firstPage, const vector<uint64_t>& starts,
+                       size_t fileRows, uint64_t bytes, uint64_t written) {
+        lock_guard<mutex> guard(pagesLock);
+        if (replaced || !file) {
+            // 打不开时沿用旧文件和旧位置(旧文件仍打开着, 内容不变), 只是新页不能换出
+            auto opened = make_shared<PageFile>(path);
+            if (opened->fd < 0) return;
+            retired = move(file);
+            file = opened;
+            for (Page& page : pages) page.located = page.inFile = false;
+            clearList();
+        }
+        for (size_t k = 0; k < starts.size() && firstPage + k < pages.size(); k++) {
+            pages[firstPage + k].begin = starts[k];
+            pages[firstPage + k].located = true;
+        }
+        for (size_t p = 0; (p + 1) * QA_CHUNK_ROWS <= fileRows && p < pages.size(); p++) {
+            Page& page = pages[p];
+            if (page.inFile || !page.located) continue;
+            if ((p + 1) * QA_CHUNK_ROWS == fileRows) page.end = bytes;
+            else if (pages[p + 1].located) page.end = pages[p + 1].begin;
+            else continue;
+            page.inFile = true;
+        }
+        fileVersion = written;
+        // 刚写入文件的页和修改已写入的页变为可换出, 按页序放到表头
+        for (size_t p = 0; p < pages.size(); p++) {
+            if (!pages[p].listed) touch(p);
+        }
+        evict();
+    }
+    
+    // 当前版本号, 每次添加或评分加一
+    uint64_t currentVersion() const { return version; }
+    
+    // 关闭整体替换前的旧文件: 已删除的大文件最后一次关闭时要释放全部数据块, 不应在写锁内进行
+    void closeRetired() {
+        shared_ptr<PageFile> old;
+        {
+            lock_guard<mutex> guard(pagesLock);
+            old.swap(retired);
+        }
+    }
+    
+    // 第p页已换出时从答疑文件取回它[begin, end)的原文, 在内存中时返回false.
+    // 换出的页自上次提交后没有修改, 原文就是它的内容
+    bool pageText(size_t p, string& text) const {
+        unique_lock<mutex> guard(pagesLock);
+        const Page& page = pages[p];
+        if (page.data || !page.inFile) return false;
+        shared_ptr<PageFile> source = file;
+        uint64_t begin = page.begin, end = page.end;
+        guard.unlock();
+        text.resize(end - begin);
+        return pread(source->fd, &text[0], text.size(), begin) == static_cast<ssize_t>(text.size());
+    }
+    
+    // 预先读入第p页, 调用方只需持有符号表的读锁, 读入期间答疑记录的修改不必等待
+    void prefetch(size_t p) const {
+        load(p);
+    }
+    
+    // 依次访问每页及页内的有效行数(二进制快照按列写出)
+    template <class F>
+    void forEachChunk(F visit) const {
+        for (size_t p = 0; p < pages.size(); p++) {
+            shared_ptr<QAChunk> c = load(p);
+            visit(*c, rowsIn(p));
+        }
+    }
+    
+    bool hasUnrated(Handle sid, Handle tid, Handle cid) const {
+        return unrated.find(QAKey{sid, tid, cid}) != unrated.end();
+    }
+    
+    // 为最早的一条未评分记录打分并出队; 评分不在1-10时不做修改, 返回false
+    bool rate(Handle sid, Handle tid, Handle cid, int rating) {
+        if (rating < 1 || rating > 10) return false;
+        auto it = unrated.find(QAKey{sid, tid, cid});
+        if (it == unrated.end()) return false;
+        uint32_t head = it->second.first;
+        modify(head).rating[head % QA_CHUNK_ROWS] = static_cast<uint8_t>(rating);
+        teacherAgg[tid].hist[0]--;
+        teacherAgg[tid].hist[rating]++;
+        courseAgg[cid].hist[0]--;
+        courseAgg[cid].hist[rating]++;
+        uint32_t next = unlink(head);
+        if (next == NO_RECORD) {
+            unrated.erase(it);
+        } else {
+            it->second.first = next;
+        }
+        if (head < persistedRows) reratedRows.push_back(head);
+        return true;
+    }
+    
+    // 增量保存: 上次保存之后新增的行从persisted()开始, 已保存行中被评分的见rerated()
+    size_t persisted() const { return persistedRows; }
+    const vector<uint32_t>& rerated() const { return reratedRows; }
+    
+    void markPersisted() {
+        persistedRows = rows;
+        reratedRows.clear();
+    }
+    
+    // 增量维护的评分统计, O(1)
+    const RatingStats& teacherAggregate(Handle tid) const { return aggregate(teacherAgg, tid); }
+    const RatingStats& courseAggregate(Handle cid) const { return aggregate(courseAgg, cid); }
+    
+    // 以全表重新统计的结果校验增量统计, 返回不一致的教师和课程数
+    size_t checkAggregates() const {
+        size_t bad = 0;
+        auto check = [&](Filter filter, const vector<RatingStats>& aggs) {
+            vector<RatingStats> full = statsGrouped(filter, aggs.size());
+            for (size_t h = 0; h < aggs.size(); h++) {
+                if (!equal(aggs[h].hist, aggs[h].hist + 11, full[h].hist)) bad++;
+            }
+        };
+        check(BY_TEACHER, teacherAgg);
+        check(BY_COURSE, courseAgg);
+        return bad;
+    }
+    
+    // 按添加顺序访问某位教师/学生的记录下标, 只读入其出现过的页; visit返回false时提前结束
+    template <class F>
+    void forEachTeacherRecord(Handle tid, F visit) const {
+        walk(BY_TEACHER, &QAChunk::teacher, tid, visit);
+    }
+    
+    template <class F>
+    void forEachStudentRecord(Handle sid, F visit) const {
+        walk(BY_STUDENT, &QAChunk::student, sid, visit);
+    }
+    
+    size_t teacherRecordCount(Handle tid) const {
+        return tid < byTeacher.size() ? byTeacher[tid].size : 0;
+    }
+    
+    size_t studentRecordCount(Handle sid) const {
+        return sid < byStudent.size() ? byStudent[sid].size : 0;
+    }
+    
+    QAInfo at(size_t idx) const {
+        shared_ptr<QAChunk> page = load(idx / QA_CHUNK_ROWS);
+        const QAChunk& c = *page;
+        size_t r = idx % QA_CHUNK_ROWS;
+        return QAInfo(c.teacher[r], c.student[r], c.course[r], c.time[r], c.rating[r]);
+    }
+    
+    size_t size() const { return rows; }
+    
+    static const Handle* keyColumn(const QAChunk& c, Filter filter) {
+        if (filter == BY_TEACHER) return c.teacher;
+        if (filter == BY_STUDENT) return c.student;
+        if (filter == BY_COURSE) return c.course;
+        return nullptr;
+    }
+    
+    // 时间窗[from, to)与各页求交: 跳过时间范围不相交的页(不必读入); 整页落在窗内或页内时间有序时
+    // 直接给出行区间[b, e), 否则给出整页并要求逐行检查时间. only不为空时只看其中的页.
+    // visit(页, 页首记录下标, b, e, 是否逐行检查时间)
+    template <class F>
+    void forEachWindowRange(const HandleSet* only, int64_t from, int64_t to, F visit) const {
+        size_t total = only ? only->size() : pages.size();
+        for (size_t k = 0; k < total; k++) {
+            size_t i = only ? only->begin()[k] : k;
+            const Page& page = pages[i];
+            if (page.maxTime < from || page.minTime >= to) continue;
+            shared_ptr<QAChunk> data = load(i);
+            const QAChunk& c = *data;
+            size_t n = rowsIn(i);
+            if (page.minTime >= from && page.maxTime < to) {
+                visit(c, i * QA_CHUNK_ROWS, 0, n, false);
+            } else if (page.ordered) {
+                size_t b = lower_bound(c.time, c.time + n, from) - c.time;
+                size_t e = lower_bound(c.time + b, c.time + n, to) - c.time;
+                if (b < e) visit(c, i * QA_CHUNK_ROWS, b, e, false);
+            } else {
+                visit(c, i * QA_CHUNK_ROWS, 0, n, true);
+            }
+        }
+    }
+    
+    // 时间窗内(filter不为ALL时只取key的)记录下标, 按添加顺序
+    vector<size_t> recordsInWindow(Filter filter, Handle key, int64_t from, int64_t to) const {
+        PROFILE_SCOPE(PROF_SCAN);
+        vector<size_t> result;
+        forEachWindowRange(pagesOf(filter, key), from, to, [&](const QAChunk& c, size_t base, size_t b, size_t e, bool checkTime) {
+            PROFILE_BYTES(PROF_SCAN, (e - b) * (sizeof(Handle) + sizeof(int64_t)), 0);
+            const Handle* keys = keyColumn(c, filter);
+            for (size_t r = b; r < e; r++) {
+                if (keys && keys[r] != key) continue;
+                if (checkTime && (c.time[r] < from || c.time[r] >= to)) continue;
+                result.push_back(base + r);
+            }
+        });
+        return result;
+    }
+    
+    // 评分统计, 默认覆盖全部时间; 只扫描与时间窗相交的页, 不分配内存
+    RatingStats stats(Filter filter, Handle key, int64_t from = INT64_MIN, int64_t to = INT64_MAX) const {
+        PROFILE_SCOPE(PROF_SCAN);
+        RatingStats result;
+        forEachWindowRange(pagesOf(filter, key), from, to, [&](const QAChunk& c, size_t, size_t b, size_t e, bool checkTime) {
+            PROFILE_BYTES(PROF_SCAN, (e - b) * (filter == ALL ? 1 : sizeof(Handle) + 1), 0);
+            const Handle* keys = keyColumn(c, filter);
+            if (!checkTime) {
+                rateHistogram(keys ? keys + b : nullptr, c.rating + b, e - b, key, result);
+                return;
+            }
+            for (size_t r = b; r < e; r++) {
+                uint8_t v = c.rating[r];
+                if ((!keys || keys[r] == key) && c.time[r] >= from && c.time[r] < to && v >= 1 && v <= 10) {
+                    result.hist[v]++;
+                }
+            }
+        });
+        return result;
+    }
+    
+    // 全院(学期)报表: 一趟扫描得到时间窗内每位教师(或每门课程)的评分统计, 结果以句柄为下标,
+    // hist[0]为未评分的记录条数
+    vector<RatingStats> statsGrouped(Filter filter, size_t groups,
+                                     int64_t from = INT64_MIN, int64_t to = INT64_MAX) const {
+        PROFILE_SCOPE(PROF_SCAN);
+        vector<RatingStats> result(groups);
+        forEachWindowRange(nullptr, from, to, [&](const QAChunk& c, size_t, size_t b, size_t e, bool checkTime) {
+            PROFILE_BYTES(PROF_SCAN, (e - b) * (sizeof(Handle) + 1), 0);
+            const Handle* keys = filter == BY_COURSE ? c.course :
+                                 filter == BY_STUDENT ? c.student : c.teacher;
+            for (size_t i = b; i < e; i++) {
+                uint8_t r = c.rating[i];
+                if (checkTime && (c.time[i] < from || c.time[i] >= to)) continue;
+                if (keys[i] < groups && r <= 10) result[keys[i]].hist[r]++;
+            }
+        });
+        return result;
+    }
+};
+
+// 按课程ID排序的课程名单, 显示和保存的顺序与句柄分配顺序无关
+vector<string_view> sortedCourseNames(const HandleSet& courses, const SymbolTable& courseIds) {
+    vector<string_view> names;
+    for (Handle c : courses) names.push_back(courseIds.name(c));
+    sort(names.begin(), names.end());
+    return names;
+}
+
+// 课程列表的读写, 教师和学生共用 "C101,C102" 格式
+void saveCourseList(OutputBuffer& out, const HandleSet& courses, const SymbolTable& courseIds) {
+    vector<string_view> names = sortedCourseNames(courses, courseIds);
+    for (size_t i = 0; i < names.size(); i++) {
+        if (i > 0) out << ',';
+        out << names[i];
+    }
+}
+
+void loadCourseList(string_view courseList, HandleSet& courses, SymbolTable& courseIds) {
+    string_view f[2];
+    while (!courseList.empty()) {
+        size_t n = splitView(courseList, ',', f, 2);
+        if (!f[0].empty()) {
+            courses.insert(courseIds.intern(f[0]));
+        }
+        courseList = n == 2 ? f[1] : string_view();
+    }
+}
+
+// 教师类
+class Teacher {
+private:
+    Handle handle;
+    string teacherID;
+    string password;
+    HandleSet courses; // 教授的课程, 答疑记录统一存放在QAStore
+
+public:
+    Teacher() : handle(NO_HANDLE), teacherID(""), password("") {}
+    Teacher(Handle h, string id, string pwd) : handle(h), teacherID(id), password(pwd) {}
+    
+    Handle getHandle() const { return handle; }
+    const string& getID() const { return teacherID; }
+    const string& getPassword() const { return password; }
+    void setPassword(string pwd) { password = pwd; }
+    
+    bool hasCourse(Handle course) const {
+        return courses.contains(course);
+    }
+    
+    // 返回是否实际修改, 提示信息由ManagementSystem输出
+    bool addCourse(Handle course) {
+        return courses.insert(course);
+    }
+    
+    bool deleteCourse(Handle course) {
+        return courses.erase(course);
+    }
+    
+    // 批量导入: list升序无重复, 返回新增的门数
+    size_t addCourses(const vector<Handle>& list) {
+        return courses.merge(list.data(), list.data() + list.size());
+    }
+    
+    void searchCourses(const SymbolTable& courseIds, ostream& out) const {
+        if (courses.empty()) {
+            out << "暂无教授课程!" << '\n';
+            return;
+        }
+        out << "教授的课程列表:" << '\n';
+        for (string_view name : sortedCourseNames(courses, courseIds)) {
+            out << "- " << name << '\n';
+        }
+    }
+    
+    const HandleSet& getCourses() const { return courses; }
+    void setCourses(vector<Handle> list) { courses.assign(move(list)); }
+    
+    // 文件操作
+    void saveToFile(OutputBuffer& out, const SymbolTable& courseIds) const {
+        out << teacherID << '|' << password << '|';
+        saveCourseList(out, courses, courseIds);
+        out << '\n';
+    }
+    
+    // 读取一行 "ID|密码|课程1,课程2"
+    void loadFromLine(string_view line, Symbols& ids) {
+        string_view f[3];
+        size_t n = splitView(line, '|', f, 3);
+        teacherID.assign(f[0]);
+        password.assign(n > 1 ? f[1] : string_view());
+        handle = ids.teachers.intern(f[0]);
+        if (n > 2) loadCourseList(f[2], courses, ids.courses);
+    }
+    
+    // 并行加载后把局部句柄换算为全局句柄
+    void remap(const vector<Handle>& selfMap, const vector<Handle>& courseMap) {
+        handle = selfMap[handle];
+        courses.remap(courseMap);
+    }
+};
+
+// 学生类
+class Student {
+private:
+    Handle handle;
+    string studentID;
+    string password;
+    HandleSet courses; // 选修的课程
+
+public:
+    Student() : handle(NO_HANDLE), studentID(""), password("") {}
+    Student(Handle h, string id, string pwd) : handle(h), studentID(id), password(pwd) {}
+    
+    Handle getHandle() const { return handle; }
+    const string& getID() const { return studentID; }
+    const string& getPassword() const { return password; }
+    void setPassword(string pwd) { password = pwd; }
+    
+    bool hasCourse(Handle course) const {
+        return courses.contains(course);
+    }
+    
+    // 返回是否实际修改, 提示信息由ManagementSystem输出
+    bool selectCourse(Handle course) {
+        return courses.insert(course);
+    }
+    
+    bool unselectCourse(Handle course) {
+        return courses.erase(course);
+    }
+    
+    // 批量导入: list升序无重复, 返回新增的门数
+    size_t selectCourses(const vector<Handle>& list) {
+        return courses.merge(list.data(), list.data() + list.size());
+    }
+    
+    void searchCourses(const SymbolTable& courseIds, ostream& out) const {
+        if (courses.empty()) {
+            out << "暂无选修课程!" << '\n';
+            return;
+        }
+        out << "选修的课程列表:" << '\n';
+        for (string_view name : sortedCourseNames(courses, courseIds)) {
+            out << "- " << name << '\n';
+        }
+    }
+    
+    const HandleSet& getCourses() const { return courses; }
+    void setCourses(vector<Handle> list) { courses.assign(move(list)); }
+    
+    // 文件操作
+    void saveToFile(OutputBuffer& out, const SymbolTable& courseIds) const {
+        out << studentID << '|' << password << '|';
+        saveCourseList(out, courses, courseIds);
+        out << '\n';
+    }
+    
+    // 读取一行 "ID|密码|课程1,课程2"
+    void loadFromLine(string_view line, Symbols& ids) {
+        string_view f[3];
+        size_t n = splitView(line, '|', f, 3);
+        studentID.assign(f[0]);
+        password.assign(n > 1 ? f[1] : string_view());
+        handle = ids.students.intern(f[0]);
+        if (n > 2) loadCourseList(f[2], courses, ids.courses);
+    }
+    
+    // 并行加载后把局部句柄换算为全局句柄
+    void remap(const vector<Handle>& selfMap, const vector<Handle>& courseMap) {
+        handle = selfMap[handle];
+        courses.remap(courseMap);
+    }
+};
+
+// 以句柄为下标的实体表: 句柄稠密, 查找直接定位, 不经过树或哈希.
+// 表项按1024个一块连续存放, 块分配后不再移动, 登录返回的指针在表增长时仍然有效;
+// 遍历按句柄顺序, 跳过没有实体的句柄(如只在答疑记录中出现过的ID)
+template <class T>
+class EntityTable {
+private:
+    static const size_t BLOCK_ITEMS = 1024;
+    vector<unique_ptr<T[]>> blocks;
+    vector<bool> present;
+    size_t count = 0;
+
+public:
+    typedef T value_type;
+    
+    T* find(Handle h) {
+        return h < present.size() && present[h] ? &blocks[h / BLOCK_ITEMS][h % BLOCK_ITEMS] : nullptr;
+    }
+    
+    const T* find(Handle h) const {
+        return const_cast<EntityTable*>(this)->find(h);
+    }
+    
+    // 写入h处的实体(已存在则覆盖), 返回表中的实体
+    T& put(Handle h, T&& value) {
+        if (h >= present.size()) present.resize(h + 1, false);
+        while (blocks.size() * BLOCK_ITEMS <= h) blocks.emplace_back(new T[BLOCK_ITEMS]);
+        T& slot = blocks[h / BLOCK_ITEMS][h % BLOCK_ITEMS];
+        slot = move(value);
+        if (!present[h]) {
+            present[h] = true;
+            count++;
+        }
+        return slot;
+    }
+    
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    
+    // 遍历时得到(句柄, 实体)对, 用法与map相同
+    class const_iterator {
+    private:
+        const EntityTable* table;
+        Handle h;
+        
+        void skip() {
+            while (h < table->present.size() && !table->present[h]) h++;
+        }
+    
+    public:
+        const_iterator(const EntityTable* t, Handle start) : table(t), h(start) { skip(); }
+        
+        pair<Handle, const T&> operator*() const { return {h, *table->find(h)}; }
+        const_iterator& operator++() {
+            h++;
+            skip();
+            return *this;
+        }
+        bool operator!=(const const_iterator& other) const { return h != other.h; }
+    };
+    
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, static_cast<Handle>(present.size())); }
+};
+
+// 上次保存之后修改过的实体句柄, 增量保存时只写出这些实体
+class DirtySet {
+private:
+    vector<bool> marked;
+    vector<Handle> list;
+
+public:
+    void mark(Handle h) {
+        if (h >= marked.size()) marked.resize(h + 1);
+        if (marked[h]) return;
+        marked[h] = true;
+        list.push_back(h);
+    }
+    
+    size_t size() const { return list.size(); }
+    bool empty() const { return list.empty(); }
+    
+    // 按句柄升序, 写出的文件与整体重写时的顺序一致
+    vector<Handle> sorted() const {
+        vector<Handle> result = list;
+        sort(result.begin(), result.end());
+        return result;
+    }
+    
+    void clear() {
+        for (Handle h : list) marked[h] = false;
+        list.clear();
+    }
+};
+
+// 文本快照文件与内存的对应关系, 用于判断能否增量保存
+struct TextFileState {
+    bool known = false; // 文件内容与上次加载或保存时一致
+    uint64_t bytes = 0; // 当时的文件大小, 不符说明文件被外部改动过
+    size_t lines = 0;   // 行数, 包括被后面同ID的行覆盖的旧行
+};
+
+// 追加写日志: 每次修改追加一条记录, 攒批后一次write+fdatasync提交
+// 可被多个会话线程同时使用; 同一时刻只有一个线程在刷盘, 其余线程的记录并入下一批
+// 记录格式与.dat文件一致, 以'|'分隔, 首字段为操作类型:
+//   Q|教师|学生|课程|时间   添加答疑      R|教师|学生|课程|评分   评分
+//   TA/TD|教师|课程         教师增删课程  SA/SD|学生|课程         学生选退课
+//   TN/SN|ID|密码           新用户注册    TP/SP|ID|密码           修改密码
+//   NC|课程|名称|时间|B/X   新建课程
+//   C|代数                  检查点标记: 之前的记录已包含在该代检查点的快照里
+class Journal {
+private:
+    string path;
+    int fd;
+    mutex lock;
+    condition_variable flushed;
+    string pending;    // 已追加但尚未提交的记录
+    size_t records;    // 自上次检查点以来的记录数
+    uint64_t appended; // 最后一条追加记录的序号
+    uint64_t durable;  // 已处理的最大序号, 其中写出失败的批次记在failed里
+    bool flushing;     // 是否有线程正在刷盘
+    vector<pair<uint64_t, uint64_t>> failed; // 写出或落盘失败的批次(首序号, 末序号), 这些记录没有持久化
+    
+    // 写出一批记录并落盘; 失败时把文件截回写这批之前的长度, 写了一半的记录不会夹在后面的批次之前
+    bool writeAll(const string& batch) {
+        if (batch.empty() || fd < 0) return batch.empty();
+        PROFILE_SCOPE(PROF_JOURNAL);
+        PROFILE_BYTES(PROF_JOURNAL, 0, batch.size());
+        struct stat st;
+        off_t before = ::fstat(fd, &st) == 0 ? st.st_size : -1;
+        bool ok = writeFully(fd, batch);
+        if (!ok) {
+            cerr << "日志写入失败: " << path << endl;
+        } else if (::fdatasync(fd) != 0) {
+            cerr << "日志落盘失败: " << path << endl;
+            ok = false;
+        }
+        if (!ok && before >= 0 && ::ftruncate(fd, before) != 0) {
+            cerr << "日志截断失败: " << path << endl;
+        }
+        return ok;
+    }
+
+public:
+    Journal(string file)
+        : path(file), fd(-1), records(0), appended(0), durable(0), flushing(false) {}
+    
+    ~Journal() {
+        commit();
+        if (fd >= 0) ::close(fd);
+    }
+    
+    // 读取上次运行留下的日志, 只返回完整的行; 截掉崩溃时写了一半的尾部.
+    // 只返回已提交的第generation代检查点标记之后的记录(没有该标记时返回全部)
+    vector<string> recover(uint64_t generation) {
+        vector<string> lines;
+        ifstream in(path, ios::binary);
+        string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        in.close();
+        
+        string marker = markerOf(generation);
+        size_t start = 0, end;
+        while ((end = content.find('\n', start)) != string::npos) {
+            string line = content.substr(start, end - start);
+            trimLineEnd(line);
+            if (line == marker) {
+                lines.clear();
+            } else if (!line.empty() && line.compare(0, 2, "C|") != 0) {
+                lines.push_back(line);
+            }
+            start = end + 1;
+        }
+        
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd >= 0 && start < content.size()) {
+            if (::ftruncate(fd, start) != 0) {
+                cerr << "日志截断失败: " << path << endl;
+            }
+        }
+        records = lines.size();
+        return lines;
+    }
+    
+    // 返回记录序号, 之后用commit(序号)等待它落盘
+    uint64_t append(const string& record) {
+        lock_guard<mutex> guard(lock);
+        pending += record;
+        pending += '\n';
+        records++;
+        return ++appended;
+    }
+    
+    // 组提交: 等到序号seq及之前的记录落盘; 没有线程在刷盘时由当前线程把所有待写记录
+    // 一次write+fdatasync写出, 否则等那一批写完再看是否还需要自己刷.
+    // seq所在的批次写出失败时返回false, 同一批次的所有等待者都得到false
+    bool commit(uint64_t seq) {
+        unique_lock<mutex> guard(lock);
+        while (durable < seq) {
+            if (flushing) {
+                flushed.wait(guard);
+                continue;
+            }
+            flushing = true;
+            string batch;
+            batch.swap(pending);
+            uint64_t upto = appended;
+            guard.unlock();
+            bool ok = writeAll(batch);
+            guard.lock();
+            flushing = false;
+            if (!ok && upto > durable) failed.emplace_back(durable + 1, upto);
+            durable = upto;
+            flushed.notify_all();
+        }
+        for (const auto& range : failed) {
+            if (seq >= range.first && seq <= range.second) return false;
+        }
+        return true;
+    }
+    
+    bool commit() {
+        uint64_t seq;
+        {
+            lock_guard<mutex> guard(lock);
+            seq = appended;
+        }
+        return commit(seq);
+    }
+    
+    static string markerOf(uint64_t generation) {
+        return "C|" + to_string(generation);
+    }
+    
+    // 检查点切出视图时追加本代标记, 返回其序号; 之后的记录计入下一次检查点
+    uint64_t mark(uint64_t generation) {
+        lock_guard<mutex> guard(lock);
+        pending += markerOf(generation);
+        pending += '\n';
+        records = 0;
+        return ++appended;
+    }
+    
+    // 检查点提交后丢弃标记之前的记录: 标记及其后的记录复制到临时文件, 落盘后改名替换.
+    // 期间占住刷盘权, 其它线程照常追加, 需要落盘的等这次换完文件
+    void compact(uint64_t generation) {
+        unique_lock<mutex> guard(lock);
+        flushed.wait(guard, [this] { return !flushing; });
+        flushing = true;
+        guard.unlock();
+        
+        ifstream in(path, ios::binary);
+        string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        in.close();
+        string marker = markerOf(generation) + '\n';
+        size_t at = content.rfind(marker);
+        while (at != string::npos && at > 0 && content[at - 1] != '\n') {
+            at = content.rfind(marker, at - 1);
+        }
+        bool replaced = false;
+        if (at != string::npos && at > 0) {
+            string tmp = path + ".tmp";
+            replaced = writeFile(tmp, string_view(content).substr(at)) && ::rename(tmp.c_str(), path.c_str()) == 0;
+            if (replaced) syncDirectory();
+            else ::unlink(tmp.c_str());
+        }
+        
+        guard.lock();
+        if (replaced) {
+            if (fd >= 0) ::close(fd);
+            fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+        }
+        flushing = false;
+        flushed.notify_all();
+    }
+    
+    size_t size() {
+        lock_guard<mutex> guard(lock);
+        return records;
+    }
+};
+
+// 二进制快照: 与文本文件并存的紧凑格式, 加载时按段整块读取, 不做逐字段解析
+// 布局(本机字节序, 各段按8字节对齐):
+//   SnapshotHeader
+//   字符串表: uint64偏移[stringCount + 1] + 字符数据; 前面依次是教师/学生/课程ID(即符号表),
+//             其后是密码、课程名称、答疑时间
+//   PersonRecord[teachers], PersonRecord[students], uint32课程句柄[courseRefs]
+//   CourseRecord[courses]
+//   答疑记录各列: 教师/学生/课程句柄uint32[records], 时间int64[records], 评分uint8[records]
+//   uint64校验和(覆盖之前的全部字节)
+const string SNAPSHOT_FILE = "snapshot.bin";
+const char SNAPSHOT_MAGIC[8] = {'Q', 'A', 'S', 'N', 'A', 'P', '\r', '\n'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t teacherIds;
+    uint64_t studentIds;
+    uint64_t courseIds;
+    uint64_t teachers;
+    uint64_t students;
+    uint64_t courseRefs;
+    uint64_t courses;
+    uint64_t records;
+    uint64_t stringCount;
+    uint64_t stringBytes;
+};
+
+// 教师和学生共用: ID句柄、密码在字符串表中的下标、课程列表在courseRefs中的区间
+struct PersonRecord {
+    uint32_t handle;
+    uint32_t password;
+    uint32_t courseBegin;
+    uint32_t courseCount;
+};
+
+struct CourseRecord {
+    uint32_t handle;
+    uint32_t name;
+    uint32_t time;
+    uint32_t kind; // 'B'或'X'
+};
+
+// 每次处理8字节的FNV变体
+uint64_t checksum64(const char* data, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    for (; i < n; i++) {
+        h = (h ^ static_cast<uint8_t>(data[i])) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// 快照写缓冲: 各段依次追加, 每段补齐到8字节
+class SnapshotWriter {
+private:
+    string buf;
+
+public:
+    template <class T>
+    void put(const T& value) {
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    
+    void putBytes(const void* data, size_t n) {
+        append(data, n);
+        pad();
+    }
+    
+    // 一段分几次写入时先逐次append, 写完再补齐
+    void append(const void* data, size_t n) {
+        buf.append(static_cast<const char*>(data), n);
+    }
+    
+    void pad() {
+        buf.append((8 - buf.size() % 8) % 8, '\0');
+    }
+    
+    template <class T>
+    void putArray(const vector<T>& items) {
+        putBytes(items.data(), items.size() * sizeof(T));
+    }
+    
+    string& bytes() { return buf; }
+};
+
+// 快照读游标, 越界时置失败标志
+class SnapshotReader {
+private:
+    const char* pos;
+    const char* end;
+    bool good;
+
+public:
+    SnapshotReader(const char* data, size_t n) : pos(data), end(data + n), good(true) {}
+    
+    // 取出n字节的一段(按8字节对齐跳过填充), 失败返回nullptr
+    const char* take(size_t n) {
+        size_t padded = n + (8 - n % 8) % 8;
+        if (!good || static_cast<size_t>(end - pos) < padded) {
+            good = false;
+            return nullptr;
+        }
+        const char* p = pos;
+        pos += padded;
+        return p;
+    }
+    
+    template <class T>
+    const T* takeArray(uint64_t count) {
+        return reinterpret_cast<const T*>(take(count * sizeof(T)));
+    }
+    
+    bool ok() const { return good; }
+};
+
+// 检查点清单: 一次检查点的提交点. 检查点先把要整体重写的文件写到临时文件, 要增量保存的
+// 追加到原文件末尾, 都落盘后再原子地改名写入清单, 此时该代检查点才算完成; 之后改名临时文件、
+// 原位改写评分, 压缩日志. 启动时按清单补做改名和改写, 截掉已提交长度之后(未提交的追加)的内容,
+// 日志只重放该代标记之后的记录. 清单格式(每行一项):
+//   G|代数   F|文件|提交长度   N|临时文件|正式文件   P|评分字段偏移|评分
+const string MANIFEST_FILE = "snapshot.meta";
+
+struct Manifest {
+    uint64_t generation = 0;
+    vector<pair<string, uint64_t>> files;   // 本代快照包含的文件及其长度
+    vector<pair<string, string>> renames;   // 临时文件 -> 正式文件
+    vector<pair<uint64_t, int>> patches;    // 答疑记录文件中要原位改写的评分
+    
+    // 本代检查点整体重写path时使用的临时文件
+    static string temporary(const string& path, uint64_t generation) {
+        return path + "." + to_string(generation) + ".tmp";
+    }
+    
+    bool contains(const string& path) const {
+        for (const auto& f : files) {
+            if (f.first == path) return true;
+        }
+        return false;
+    }
+    
+    // 没有清单(旧版本的数据目录)或格式不对时返回false
+    bool load() {
+        MappedFile file(MANIFEST_FILE);
+        string_view text = file.view(), line;
+        bool valid = false;
+        while (nextLine(text, line)) {
+            string_view f[3];
+            size_t n = splitView(line, '|', f, 3);
+            if (n == 2 && f[0] == "G") {
+                generation = strtoull(string(f[1]).c_str(), nullptr, 10);
+                valid = true;
+            } else if (n == 3 && f[0] == "F") {
+                files.emplace_back(string(f[1]), strtoull(string(f[2]).c_str(), nullptr, 10));
+            } else if (n == 3 && f[0] == "N") {
+                renames.emplace_back(string(f[1]), string(f[2]));
+            } else if (n == 3 && f[0] == "P") {
+                patches.emplace_back(strtoull(string(f[1]).c_str(), nullptr, 10), atoi(string(f[2]).c_str()));
+            }
+        }
+        return valid;
+    }
+    
+    // 写临时清单, 落盘后改名替换: 改名完成即提交
+    bool save() const {
+        string text = "G|" + to_string(generation) + "\n";
+        for (const auto& f : files) text += "F|" + f.first + "|" + to_string(f.second) + "\n";
+        for (const auto& r : renames) text += "N|" + r.first + "|" + r.second + "\n";
+        for (const auto& p : patches) text += "P|" + to_string(p.first) + "|" + to_string(p.second) + "\n";
+        string tmp = MANIFEST_FILE + ".tmp";
+        if (!writeFile(tmp, text) || ::rename(tmp.c_str(), MANIFEST_FILE.c_str()) != 0) {
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        syncDirectory();
+        return true;
+    }
+    
+    // 完成已提交的检查点, 可重复执行: 临时文件还在就改名, 评分照写, 多出的尾部截掉
+    void apply() const {
+        for (const auto& r : renames) {
+            if (fileSize(r.first) >= 0) ::rename(r.first.c_str(), r.second.c_str());
+        }
+        syncDirectory();
+        if (!patches.empty()) {
+            int fd = ::open(QA_FILE.c_str(), O_WRONLY);
+            if (fd >= 0) {
+                for (const auto& p : patches) {
+                    char digits[2] = {static_cast<char>('0' + p.second / 10), static_cast<char>('0' + p.second % 10)};
+                    if (::pwrite(fd, digits, 2, p.first) != 2) break;
+                }
+                ::fsync(fd);
+                ::close(fd);
+            }
+        }
+        for (const auto& f : files) {
+            if (fileSize(f.first) > static_cast<int64_t>(f.second)) {
+                if (::truncate(f.first.c_str(), f.second) == 0) syncFile(f.first);
+            }
+        }
+    }
+    
+    // 未提交的检查点留下的临时文件
+    static void discard(uint64_t generation) {
+        for (const string* path : {&TEACHER_FILE, &STUDENT_FILE, &COURSE_FILE, &QA_FILE, &SNAPSHOT_FILE}) {
+            ::unlink(temporary(*path, generation).c_str());
+        }
+    }
+};
+
+// 固定大小的线程池, 任务按提交顺序取出执行
+class ThreadPool {
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex lock;
+    condition_variable ready;
+    bool stopping;
+    
+    void run() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> guard(lock);
+                ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threads) : stopping(false) {
+        for (size_t i = 0; i < max<size_t>(threads, 1); i++) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (thread& w : workers) w.join();
+    }
+    
+    template <class F>
+    auto submit(F task) -> future<decltype(task())> {
+        auto job = make_shared<packaged_task<decltype(task())()>>(move(task));
+        auto result = job->get_future();
+        {
+            lock_guard<mutex> guard(lock);
+            tasks.emplace([job] { (*job)(); });
+        }
+        ready.notify_one();
+        return result;
+    }
+    
+    size_t size() const { return workers.size(); }
+};
+
+// 密码散列(PBKDF2-HMAC-SHA256)的默认迭代次数, 一次校验约数毫秒; 实际次数记录在每个散列中
+const uint32_t PASSWORD_HASH_ITERATIONS = 10000;
+// 认证通过后会话缓存的有效期, 期间同一用户再次认证不重新计算散列
+const int SESSION_TTL_SECONDS = 300;
+// 会话缓存的最大条数, 超过时先清掉过期项
+const size_t SESSION_CACHE_LIMIT = 1 << 16;
+
+// SHA-256 (FIPS 180-4)
+class Sha256 {
+private:
+    uint32_t state[8];
+    uint8_t block[64];
+    uint64_t length = 0; // 已输入的字节数
+    size_t used = 0;     // block中已有的字节数
+    
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+    
+    void compress(const uint8_t* p) {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = uint32_t(p[4 * i]) << 24 | uint32_t(p[4 * i + 1]) << 16 | uint32_t(p[4 * i + 2]) << 8 | p[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+public:
+    static const size_t DIGEST_SIZE = 32;
+    
+    Sha256() {
+        static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(state, init, sizeof(state));
+    }
+    
+    Sha256& update(const void* data, size_t n) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        length += n;
+        if (used) {
+            size_t take = min(n, 64 - used);
+            memcpy(block + used, p, take);
+            used += take;
+            p += take;
+            n -= take;
+            if (used < 64) return *this;
+            compress(block);
+            used = 0;
+        }
+        for (; n >= 64; p += 64, n -= 64) compress(p);
+        memcpy(block, p, n);
+        used = n;
+        return *this;
+    }
+    
+    void finish(uint8_t out[DIGEST_SIZE]) {
+        uint64_t bits = length * 8;
+        uint8_t pad[72] = {0x80};
+        size_t padLen = (used < 56 ? 56 : 120) - used;
+        for (int i = 0; i < 8; i++) pad[padLen + i] = uint8_t(bits >> (56 - 8 * i));
+        update(pad, padLen + 8);
+        for (int i = 0; i < 8; i++) {
+            out[4 * i] = uint8_t(state[i] >> 24);
+            out[4 * i + 1] = uint8_t(state[i] >> 16);
+            out[4 * i + 2] = uint8_t(state[i] >> 8);
+            out[4 * i + 3] = uint8_t(state[i]);
+        }
+    }
+};
+
+// 逐字节比较且不提前退出, 耗时与内容无关
+bool sameBytes(const void* a, const void* b, size_t n) {
+    const uint8_t* x = static_cast<const uint8_t*>(a);
+    const uint8_t* y = static_cast<const uint8_t*>(b);
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; i++) diff |= x[i] ^ y[i];
+    return diff == 0;
+}
+
+// PBKDF2-HMAC-SHA256, 只取第一块(32字节); salt不超过60字节
+void pbkdf2Sha256(string_view password, const uint8_t* salt, size_t saltSize, uint32_t iterations,
+                  uint8_t out[Sha256::DIGEST_SIZE]) {
+    uint8_t key[64] = {};
+    if (password.size() > sizeof(key)) Sha256().update(password.data(), password.size()).finish(key);
+    else memcpy(key, password.data(), password.size());
+    uint8_t pad[64];
+    Sha256 inner, outer; // 压缩过密钥块的HMAC内外层状态, 每轮复制后接着用
+    for (int i = 0; i < 64; i++) pad[i] = key[i] ^ 0x36;
+    inner.update(pad, 64);
+    for (int i = 0; i < 64; i++) pad[i] = key[i] ^ 0x5c;
+    outer.update(pad, 64);
+    auto hmac = [&](const uint8_t* message, size_t n, uint8_t* mac) {
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        Sha256 in = inner;
+        in.update(message, n).finish(digest);
+        Sha256 out = outer;
+        out.update(digest, sizeof(digest)).finish(mac);
+    };
+    uint8_t first[64];
+    memcpy(first, salt, saltSize);
+    const uint8_t blockIndex[4] = {0, 0, 0, 1};
+    memcpy(first + saltSize, blockIndex, 4);
+    uint8_t u[Sha256::DIGEST_SIZE];
+    hmac(first, saltSize + 4, u);
+    memcpy(out, u, sizeof(u));
+    for (uint32_t k = 1; k < iterations; k++) {
+        hmac(u, sizeof(u), u);
+        for (size_t i = 0; i < sizeof(u); i++) out[i] ^= u[i];
+    }
+}
+
+// 存储的密码: "$pbkdf2-sha256$迭代次数$盐$散列", 盐和散列为十六进制;
+// 不是这种格式的是旧数据中的明文密码, 首次登录成功后换成散列
+namespace PasswordHash {
+    const string PREFIX = "$pbkdf2-sha256$";
+    const size_t SALT_SIZE = 16;
+    
+    bool isHashed(string_view stored) {
+        return stored.compare(0, PREFIX.size(), PREFIX) == 0;
+    }
+    
+    string toHex(const uint8_t* data, size_t n) {
+        static const char digits[] = "0123456789abcdef";
+        string text(n * 2, '0');
+        for (size_t i = 0; i < n; i++) {
+            text[2 * i] = digits[data[i] >> 4];
+            text[2 * i + 1] = digits[data[i] & 15];
+        }
+        return text;
+    }
+    
+    bool fromHex(string_view text, uint8_t* data, size_t n) {
+        if (text.size() != n * 2) return false;
+        auto digit = [](char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        };
+        for (size_t i = 0; i < n; i++) {
+            int hi = digit(text[2 * i]), lo = digit(text[2 * i + 1]);
+            if (hi < 0 || lo < 0) return false;
+            data[i] = uint8_t(hi << 4 | lo);
+        }
+        return true;
+    }
+    
+    string make(string_view password, uint32_t iterations) {
+        uint8_t salt[SALT_SIZE];
+        random_device rd;
+        for (size_t i = 0; i < SALT_SIZE; i += 4) {
+            uint32_t r = rd();
+            memcpy(salt + i, &r, 4);
+        }
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        pbkdf2Sha256(password, salt, SALT_SIZE, iterations, digest);
+        return PREFIX + to_string(iterations) + "$" + toHex(salt, SALT_SIZE) + "$" + toHex(digest, sizeof(digest));
+    }
+    
+    bool verify(string_view stored, string_view password) {
+        if (!isHashed(stored)) {
+            return stored.size() == password.size() && sameBytes(stored.data(), password.data(), stored.size());
+        }
+        string_view rest = stored.substr(PREFIX.size());
+        size_t a = rest.find('$');
+        size_t b = a == string_view::npos ? a : rest.find('$', a + 1);
+        if (b == string_view::npos) return false;
+        uint32_t iterations = 0;
+        auto parsed = from_chars(rest.data(), rest.data() + a, iterations);
+        uint8_t salt[SALT_SIZE], expected[Sha256::DIGEST_SIZE], digest[Sha256::DIGEST_SIZE];
+        if (parsed.ec != errc() || parsed.ptr != rest.data() + a || iterations == 0 ||
+            !fromHex(rest.substr(a + 1, b - a - 1), salt, SALT_SIZE) ||
+            !fromHex(rest.substr(b + 1), expected, sizeof(expected))) {
+            return false;
+        }
+        pbkdf2Sha256(password, salt, SALT_SIZE, iterations, digest);
+        return sameBytes(digest, expected, sizeof(digest));
+    }
+}
+
+// 登录认证: 慢散列在专用线程池上计算, 多个会话同时登录时并行校验, 调用方等待结果时不持任何锁.
+// 校验通过后会话缓存记下(用户, 存储的散列, 输入的密码)的带密钥摘要, 有效期内同一用户再次认证只比较摘要;
+// 改过密码后存储的散列变了, 旧摘要自然失效
+class CredentialService {
+private:
+    struct Session {
+        uint8_t tag[Sha256::DIGEST_SIZE];
+        chrono::steady_clock::time_point expires;
+    };
+    
+    ThreadPool pool;
+    uint32_t iterations;
+    uint8_t secret[Sha256::DIGEST_SIZE]; // 会话摘要的密钥, 每次启动随机生成, 缓存里不留可离线猜测的内容
+    mutex sessionLock;
+    unordered_map<uint64_t, Session> sessions;
+    
+    void sessionTag(const string& stored, const string& password, uint8_t tag[Sha256::DIGEST_SIZE]) const {
+        uint64_t storedSize = stored.size();
+        Sha256()
+            .update(secret, sizeof(secret))
+            .update(&storedSize, sizeof(storedSize))
+            .update(stored.data(), stored.size())
+            .update(password.data(), password.size())
+            .finish(tag);
+    }
+    
+    void remember(uint64_t user, const uint8_t* tag, chrono::steady_clock::time_point now) {
+        lock_guard<mutex> guard(sessionLock);
+        if (sessions.size() >= SESSION_CACHE_LIMIT && !sessions.count(user)) {
+            for (auto it = sessions.begin(); it != sessions.end();) {
+                it = it->second.expires <= now ? sessions.erase(it) : next(it);
+            }
+            if (sessions.size() >= SESSION_CACHE_LIMIT) sessions.clear();
+        }
+        Session& s = sessions[user];
+        memcpy(s.tag, tag, sizeof(s.tag));
+        s.expires = now + chrono::seconds(SESSION_TTL_SECONDS);
+    }
+
+public:
+    // threads为0时按CPU核数
+    CredentialService(unsigned threads, uint32_t hashIterations)
+        : pool(threads ? threads : max(1u, thread::hardware_concurrency())),
+          iterations(max(1u, hashIterations)) {
+        random_device rd;
+        for (size_t i = 0; i < sizeof(secret); i += 4) {
+            uint32_t r = rd();
+            memcpy(secret + i, &r, 4);
+        }
+    }
+    
+    // 用户的会话键: 角色和句柄
+    static uint64_t userKey(bool student, Handle h) {
+        return uint64_t(student) << 32 | h;
+    }
+    
+    // 在线程池上为新密码计算散列
+    string hash(const string& password) {
+        return pool.submit([&] { return PasswordHash::make(password, iterations); }).get();
+    }
+    
+    // 校验密码; stored是调用方在读锁内取出的存储值, 调用时不得持锁
+    bool verify(uint64_t user, const string& stored, const string& password) {
+        if (!PasswordHash::isHashed(stored)) return PasswordHash::verify(stored, password);
+        uint8_t tag[Sha256::DIGEST_SIZE];
+        sessionTag(stored, password, tag);
+        auto now = chrono::steady_clock::now();
+        {
+            lock_guard<mutex> guard(sessionLock);
+            auto it = sessions.find(user);
+            if (it != sessions.end() && it->second.expires > now && sameBytes(it->second.tag, tag, sizeof(tag))) {
+                return true;
+            }
+        }
+        if (!pool.submit([&] { return PasswordHash::verify(stored, password); }).get()) return false;
+        remember(user, tag, now);
+        return true;
+    }
+    
+    // 刚设置的密码直接记入会话缓存(注册和明文升级后不必再算一次)
+    void remember(uint64_t user, const string& stored, const string& password) {
+        uint8_t tag[Sha256::DIGEST_SIZE];
+        sessionTag(stored, password, tag);
+        remember(user, tag, chrono::steady_clock::now());
+    }
+    
+    void clearSessions() {
+        lock_guard<mutex> guard(sessionLock);
+        sessions.clear();
+    }
+    
+    size_t threads() const { return pool.size(); }
+};
+
+// 快照格式: 文本(.dat文件)或二进制(snapshot.bin)
+enum class SnapshotFormat { TEXT, BINARY };
+
+// 运行配置, 由命令行参数设置
+struct SystemConfig {
+    unsigned loadThreads = 0; // 加载线程数, 0表示按CPU核数, 1表示单线程顺序加载
+    SnapshotFormat format = SnapshotFormat::TEXT;
+    bool deferCommit = false; // 为true时修改只追加日志, 由调用方定期commitPending()统一落盘(批处理导入)
+    size_t checkpointRecords = CHECKPOINT_RECORDS; // 日志达到该条数时做检查点
+    size_t residentRecords = QA_RESIDENT_RECORDS;  // 内存中最多保留的答疑记录条数, 其余按需从文件读入
+    unsigned authThreads = 0;                      // 计算密码散列的线程数, 0表示按CPU核数
+    uint32_t hashIterations = PASSWORD_HASH_ITERATIONS;
+};
+
+// 批量导入的数据: 选课(学号, 课程号)、授课(工号, 课程号)和历史答疑记录
+struct ImportBatch {
+    struct Record {
+        string teacher;
+        string student;
+        string course;
+        int64_t time;
+        int rating; // 0表示未评分
+    };
+    vector<pair<string, string>> enrollments;
+    vector<pair<string, string>> assignments;
+    vector<Record> records;
+};
+
+// 批量导入的结果汇总
+struct ImportSummary {
+    size_t enrollments = 0;    // 新增的选课
+    size_t assignments = 0;    // 新增的授课
+    size_t records = 0;        // 新增的答疑记录
+    size_t duplicates = 0;     // 批内重复或已存在的选课/授课, 批内完全相同的答疑记录
+    size_t unknownCourses = 0; // 课程不在课程表中
+    size_t unknownUsers = 0;   // 教师或学生未注册
+    size_t rejected = 0;       // 答疑记录的教师不教授或学生未选修该课程, 或评分不在0-10
+    bool durable = true;       // 本批修改的日志已落盘; 为false时内存已修改但重启后会丢失
+};
+
+// 并行加载时答疑记录文件按该大小在行边界处分块, 解析与合并交替进行, 同时解析的块数有上限
+const size_t PARALLEL_CHUNK_BYTES = 1 << 22;
+
+// 并行加载时一个任务的解析结果, 句柄属于任务自己的局部符号表, 合并时再换算.
+// spans[i]为records[i]在文件中的[起, 止)偏移
+struct LoadChunk {
+    Symbols ids;
+    vector<Teacher> teachers;
+    vector<Student> students;
+    vector<Course> courses;
+    vector<QAInfo> records;
+    vector<pair<uint64_t, uint64_t>> spans;
+    size_t skipped = 0;
+};
+
+// 以下解析函数把每行交给sink, 串行加载时sink直接写入系统, 并行时写入LoadChunk
+template <class Sink>
+void parseTeachers(string_view text, Symbols& ids, Sink sink) {
+    string_view line;
+    while (nextLine(text, line)) {
+        if (line.empty()) continue;
+        Teacher t;
+        t.loadFromLine(line, ids);
+        sink(move(t));
+    }
+}
+
+template <class Sink>
+void parseStudents(string_view text, Symbols& ids, Sink sink) {
+    string_view line;
+    while (nextLine(text, line)) {
+        if (line.empty()) continue;
+        Student s;
+        s.loadFromLine(line, ids);
+        sink(move(s));
+    }
+}
+
+// 课程行末尾的字段是类型标记
+template <class Sink>
+void parseCourses(string_view text, Sink sink) {
+    string_view line;
+    while (nextLine(text, line)) {
+        Course course;
+        if (course.loadFromLine(line)) sink(move(course));
+    }
+}
+
+// sink(记录, 行首偏移, 下一行的偏移), 偏移相对text起点; 返回跳过的格式错误行数
+template <class Sink>
+size_t parseQARecords(string_view text, Symbols& ids, Sink sink) {
+    string_view rest = text, line;
+    size_t skipped = 0;
+    while (nextLine(rest, line)) {
+        if (line.empty()) continue;
+        QAInfo qa(NO_HANDLE, NO_HANDLE, NO_HANDLE, 0, 0);
+        if (qa.loadFromLine(line, ids)) {
+            sink(qa, static_cast<uint64_t>(line.data() - text.data()),
+                 static_cast<uint64_t>(rest.data() - text.data()));
+        } else {
+            skipped++;
+        }
+    }
+    return skipped;
+}
+
+// 在行边界处把text切成最多parts段
+vector<string_view> splitAtLines(string_view text, size_t parts) {
+    vector<string_view> ranges;
+    size_t target = text.size() / max<size_t>(parts, 1) + 1;
+    while (!text.empty()) {
+        size_t cut = min(target, text.size());
+        size_t nl = text.find('\n', cut - 1);
+        cut = nl == string_view::npos ? text.size() : nl + 1;
+        ranges.push_back(text.substr(0, cut));
+        text.remove_prefix(cut);
+    }
+    return ranges;
+}
+
+// 局部句柄到全局句柄的换算表, 按局部首次出现的顺序驻留, 结果与串行加载一致
+vector<Handle> remapSymbols(const SymbolTable& local, SymbolTable& global) {
+    vector<Handle> table(local.size());
+    for (Handle h = 0; h < local.size(); h++) {
+        table[h] = global.intern(local.name(h));
+    }
+    return table;
+}
+
+// 管理系统类
+class ManagementSystem {
+private:
+    SystemConfig config;
+    
+    // 多个会话可并发调用: entityLock保护符号表和教师/学生/课程表及其内容, qaLock保护qaStore,
+    // 两把都要时先取entityLock. 修改在写锁内追加日志, 释放锁后再等待落盘
+    mutable shared_mutex entityLock;
+    mutable shared_mutex qaLock;
+    mutex checkpointLock; // 同一时刻只做一个检查点, 同时保护下面的增量保存状态和检查点代数
+    // 后台检查点线程: 日志达到阈值时由commitRecord唤醒, 前台不等待快照写盘
+    thread checkpointer;
+    mutex wakeLock;
+    condition_variable wake;
+    bool checkpointWanted = false;
+    bool stopping = false;
+    
+    Symbols ids;
+    // 表项从不删除, 登录返回的Teacher*/Student*在其它会话修改期间始终有效
+    EntityTable<Teacher> teachers;
+    EntityTable<Student> students;
+    EntityTable<Course> courses;
+    vector<const Course*> courseOrder; // 按课程ID排序, 显示和保存直接按序遍历
+    // 反向索引, 以课程句柄为下标, 随选课/退选和教师增删课程同步更新
+    vector<HandleSet> enrolled; // 选修该课程的学生
+    vector<HandleSet> teaching; // 教授该课程的教师
+    QAStore qaStore;
+    Journal journal;
+    CredentialService credentials;
+    size_t skippedRows = 0; // 加载时跳过的格式错误行
+    
+    uint64_t generation = 0;   // 已提交的检查点代数
+    bool binaryCurrent = true; // 二进制快照属于已提交的检查点(没有清单的旧数据目录按是处理)
+    
+    // 增量保存: 上次保存之后修改过的教师/学生/课程, 以及各文本文件的状态
+    DirtySet dirtyTeachers;
+    DirtySet dirtyStudents;
+    DirtySet dirtyCourses;
+    TextFileState teacherText, studentText, courseText, qaText;
+    // 答疑文件中未评分行的行号(升序)和评分字段的字节偏移; 行号小于qaOffsetsFrom的行尚未记录
+    vector<uint32_t> unratedRows;
+    vector<uint64_t> unratedOffsets;
+    size_t qaOffsetsFrom = 0;
+    // 本次检查点写出的答疑文件: 是否整体重写, 以及从第qaFirstPage页起每页首行的偏移
+    bool qaReplaced = false;
+    size_t qaFirstPage = 0;
+    vector<uint64_t> qaPageStarts;
+    
+    // 获取当前时间(本地墙上时间), 精确到分钟: 文本文件和日志都只记到分钟, 二进制快照与之保持一致
+    int64_t getCurrentTime() {
+        time_t now = time(0);
+        tm ltm;
+        localtime_r(&now, &ltm);
+        return daysFromCivil(1900 + ltm.tm_year, 1 + ltm.tm_mon, ltm.tm_mday) * 86400 +
+               ltm.tm_hour * 3600 + ltm.tm_min * 60;
+    }
+    
+    // 不持锁时调用: 等待日志落盘(并发会话的记录合并为一次fdatasync), 日志过长时唤醒检查点线程.
+    // 返回false表示记录所在的批次写入或落盘失败; deferCommit模式下由commitPending()报告
+    bool commitRecord(uint64_t seq) {
+        bool ok = config.deferCommit || journal.commit(seq);
+        if (journal.size() >= config.checkpointRecords) {
+            lock_guard<mutex> guard(wakeLock);
+            checkpointWanted = true;
+            wake.notify_one();
+        }
+        return ok;
+    }
+    
+    void checkpointLoop() {
+        unique_lock<mutex> guard(wakeLock);
+        while (true) {
+            wake.wait(guard, [this] { return checkpointWanted || stopping; });
+            if (stopping) return;
+            checkpointWanted = false;
+            guard.unlock();
+            {
+                lock_guard<mutex> single(checkpointLock);
+                if (journal.size() >= config.checkpointRecords) saveData(false);
+            }
+            guard.lock();
+        }
+    }
+    
+    // type为文件中的类型标记
+    bool createCourse(string id, string name, string time, string type) {
+        CourseKind kind;
+        if (type.size() != 1 || !CourseKinds::fromTag(type[0], kind)) return false;
+        Handle h = ids.courses.intern(id);
+        if (courses.find(h)) return false;
+        const Course* course = &courses.put(h, Course(id, name, time, kind));
+        dirtyCourses.mark(h);
+        courseOrder.insert(upper_bound(courseOrder.begin(), courseOrder.end(), course, courseLess), course);
+        return true;
+    }
+    
+    static bool courseLess(const Course* a, const Course* b) {
+        return a->getCourseID() < b->getCourseID();
+    }
+    
+    // 句柄按出现顺序分配, 加载后按课程ID排一次序, 之后新建课程时插入到位
+    void rebuildCourseOrder() {
+        courseOrder.clear();
+        for (const auto& c : courses) {
+            courseOrder.push_back(&c.second);
+        }
+        sort(courseOrder.begin(), courseOrder.end(), courseLess);
+    }
+    
+    const vector<const Course*>& sortedCourses() const { return courseOrder; }
+    
+    static HandleSet& slotOf(vector<HandleSet>& index, Handle course) {
+        if (course >= index.size()) index.resize(course + 1);
+        return index[course];
+    }
+    
+    // 加载和重放日志之后一次建立反向索引; 按句柄顺序遍历, 每份名单都是升序追加
+    void rebuildReverseIndexes() {
+        enrolled.assign(ids.courses.size(), HandleSet());
+        teaching.assign(ids.courses.size(), HandleSet());
+        for (const auto& s : students) {
+            for (Handle c : s.second.getCourses()) slotOf(enrolled, c).insert(s.first);
+        }
+        for (const auto& t : teachers) {
+            for (Handle c : t.second.getCourses()) slotOf(teaching, c).insert(t.first);
+        }
+    }
+    
+    // 反向索引中某门课程的名单, 转成ID
+    vector<string> namesIn(const vector<HandleSet>& index, const SymbolTable& table, const string& cid) const {
+        vector<string> result;
+        Handle c = ids.courses.find(cid);
+        if (c < index.size()) {
+            for (Handle h : index[c]) result.emplace_back(table.name(h));
+        }
+        return result;
+    }
+    
+    Teacher* findTeacher(const string& id) {
+        return teachers.find(ids.teachers.find(id));
+    }
+    
+    Student* findStudent(const string& id) {
+        return students.find(ids.students.find(id));
+    }
+    
+    // 调用方已确认ID未注册
+    Teacher& registerTeacher(const string& id, const string& pwd) {
+        Handle h = ids.teachers.intern(id);
+        dirtyTeachers.mark(h);
+        return teachers.put(h, Teacher(h, id, pwd));
+    }
+    
+    Student& registerStudent(const string& id, const string& pwd) {
+        Handle h = ids.students.intern(id);
+        dirtyStudents.mark(h);
+        return students.put(h, Student(h, id, pwd));
+    }
+    
+    // 旧数据中的明文密码在首次登录成功后换成散列; 期间其它会话改过密码则不动
+    void upgradePassword(Teacher* t, const string& plain, const string& pwd) {
+        string hashed = credentials.hash(pwd);
+        bool upgraded = applyEntities([&] {
+            if (t->getPassword() != plain) return string();
+            t->setPassword(hashed);
+            dirtyTeachers.mark(t->getHandle());
+            return "TP|" + t->getID() + "|" + hashed;
+        }) != UNCHANGED;
+        if (upgraded) credentials.remember(CredentialService::userKey(false, t->getHandle()), hashed, pwd);
+    }
+    
+    void upgradePassword(Student* s, const string& plain, const string& pwd) {
+        string hashed = credentials.hash(pwd);
+        bool upgraded = applyEntities([&] {
+            if (s->getPassword() != plain) return string();
+            s->setPassword(hashed);
+            dirtyStudents.mark(s->getHandle());
+            return "SP|" + s->getID() + "|" + hashed;
+        }) != UNCHANGED;
+        if (upgraded) credentials.remember(CredentialService::userKey(true, s->getHandle()), hashed, pwd);
+    }
+    
+    // 重放上次检查点之后的日志
+    void replayJournal() {
+        for (const string& line : journal.recover(generation)) {
+            vector<string> f = splitFields(line, '|');
+            const string& op = f[0];
+            if (op == "Q" && f.size() >= 5) {
+                // 批量导入的历史记录带评分, 不在0-10的记录不重放(与导入时的检查一致)
+                int rating = f.size() >= 6 ? atoi(f[5].c_str()) : 0;
+                if (rating < 0 || rating > 10) continue;
+                qaStore.add(QAInfo(ids.teachers.intern(f[1]), ids.students.intern(f[2]), ids.courses.intern(f[3]),
+                                   parseTime(f[4]), rating));
+            } else if (op == "R" && f.size() >= 5) {
+                qaStore.rate(ids.students.find(f[2]), ids.teachers.find(f[1]),
+                             ids.courses.find(f[3]), atoi(f[4].c_str()));
+            } else if (op == "TN" && f.size() >= 3) {
+                registerTeacher(f[1], f[2]);
+            } else if (op == "SN" && f.size() >= 3) {
+                registerStudent(f[1], f[2]);
+            } else if (op == "TP" && f.size() >= 3) {
+                Teacher* t = findTeacher(f[1]);
+                if (!t) continue;
+                t->setPassword(f[2]);
+                dirtyTeachers.mark(t->getHandle());
+            } else if (op == "SP" && f.size() >= 3) {
+                Student* s = findStudent(f[1]);
+                if (!s) continue;
+                s->setPassword(f[2]);
+                dirtyStudents.mark(s->getHandle());
+            } else if ((op == "TA" || op == "TD") && f.size() >= 3) {
+                Teacher* t = findTeacher(f[1]);
+                if (!t) continue;
+                if (op == "TA") t->addCourse(ids.courses.intern(f[2]));
+                else t->deleteCourse(ids.courses.find(f[2]));
+                dirtyTeachers.mark(t->getHandle());
+            } else if ((op == "SA" || op == "SD") && f.size() >= 3) {
+                Student* s = findStudent(f[1]);
+                if (!s) continue;
+                if (op == "SA") s->selectCourse(ids.courses.intern(f[2]));
+                else s->unselectCourse(ids.courses.find(f[2]));
+                dirtyStudents.mark(s->getHandle());
+            } else if (op == "NC" && f.size() >= 5) {
+                createCourse(f[1], f[2], f[3], f[4]);
+            }
+        }
+    }
+    
+    // 并行加载: 每个文件一个任务, 答疑记录按行边界分块后分给线程池, 按文件顺序合并.
+    // 解析中和待合并的答疑块不超过线程数的两倍, 合并完的块随即释放, 内存不随文件大小增长
+    void loadParallel(const MappedFile& tfile, const MappedFile& sfile,
+                      const MappedFile& cfile, const MappedFile& qfile, unsigned threads) {
+        string_view qtext = qfile.view();
+        vector<string_view> qranges = splitAtLines(qtext, qtext.size() / PARALLEL_CHUNK_BYTES + 1);
+        vector<LoadChunk> chunks(3 + qranges.size());
+        vector<future<void>> pending;
+        ThreadPool pool(threads);
+        pending.push_back(pool.submit([&] {
+            LoadChunk& c = chunks[0];
+            parseTeachers(tfile.view(), c.ids, [&c](Teacher&& t) { c.teachers.push_back(move(t)); });
+        }));
+        pending.push_back(pool.submit([&] {
+            LoadChunk& c = chunks[1];
+            parseStudents(sfile.view(), c.ids, [&c](Student&& s) { c.students.push_back(move(s)); });
+        }));
+        pending.push_back(pool.submit([&] {
+            LoadChunk& c = chunks[2];
+            parseCourses(cfile.view(), [&c](Course&& course) { c.courses.push_back(move(course)); });
+        }));
+        auto submitRecords = [&](size_t i) {
+            pending.push_back(pool.submit([&, i] {
+                LoadChunk& c = chunks[3 + i];
+                uint64_t base = qranges[i].data() - qtext.data();
+                c.skipped = parseQARecords(qranges[i], c.ids, [&c, base](const QAInfo& qa, uint64_t b, uint64_t e) {
+                    c.records.push_back(qa);
+                    c.spans.emplace_back(base + b, base + e);
+                });
+            }));
+        };
+        size_t window = 2 * static_cast<size_t>(threads);
+        for (size_t i = 0; i < qranges.size() && i < window; i++) submitRecords(i);
+        for (size_t k = 0; k < chunks.size(); k++) {
+            pending[k].get();
+            mergeChunk(chunks[k]);
+            if (k < 3) continue;
+            size_t i = k - 3;
+            qfile.release(qranges[i].data() + qranges[i].size() - qtext.data());
+            if (i + window < qranges.size()) submitRecords(i + window);
+        }
+    }
+    
+    void mergeChunk(LoadChunk& chunk) {
+        vector<Handle> tmap = remapSymbols(chunk.ids.teachers, ids.teachers);
+        vector<Handle> smap = remapSymbols(chunk.ids.students, ids.students);
+        vector<Handle> cmap = remapSymbols(chunk.ids.courses, ids.courses);
+        for (Teacher& t : chunk.teachers) {
+            t.remap(tmap, cmap);
+            teachers.put(t.getHandle(), move(t));
+        }
+        for (Student& s : chunk.students) {
+            s.remap(smap, cmap);
+            students.put(s.getHandle(), move(s));
+        }
+        for (Course& c : chunk.courses) {
+            courses.put(ids.courses.intern(c.getCourseID()), move(c));
+        }
+        for (size_t i = 0; i < chunk.records.size(); i++) {
+            QAInfo& qa = chunk.records[i];
+            qa.teacher = tmap[qa.teacher];
+            qa.student = smap[qa.student];
+            qa.course = cmap[qa.course];
+            qaStore.addFromFile(qa, chunk.spans[i].first, chunk.spans[i].second);
+        }
+        skippedRows += chunk.skipped;
+        chunk = LoadChunk();
+    }
+    
+public:
+    ManagementSystem(SystemConfig cfg = SystemConfig())
+        : config(cfg), qaStore(ids, cfg.residentRecords), journal(JOURNAL_FILE),
+          credentials(cfg.authThreads, cfg.hashIterations) {
+        recoverSnapshot();
+        loadData();
+        qaStore.markPersisted(); // 重放日志新增和评分的记录在下次保存时写出
+        replayJournal();
+        rebuildReverseIndexes();
+        rebuildCourseOrder();
+        checkpointer = thread([this] { checkpointLoop(); });
+    }
+    
+    // 退出时等正在进行的检查点做完, 然后提交日志; 快照由检查点负责
+    ~ManagementSystem() {
+        {
+            lock_guard<mutex> guard(wakeLock);
+            stopping = true;
+            wake.notify_one();
+        }
+        checkpointer.join();
+        journal.commit();
+    }
+    
+    // 加载数据: 按配置选择二进制快照或文本文件; 二进制快照不存在、已过期或损坏时退回文本文件
+    void loadData() {
+        PROFILE_SCOPE(PROF_LOAD);
+        if (config.format == SnapshotFormat::BINARY && binaryCurrent && loadBinary()) {
+            return;
+        }
+        loadText();
+    }
+    
+    // 格式转换: 两种快照都按当前内存状态整体写出并提交, 之后用哪种格式启动结果都一致
+    void convertSnapshot() {
+        lock_guard<mutex> single(checkpointLock);
+        runCheckpoint(true, true, true);
+    }
+    
+private:
+    // 完成上次运行已提交但没做完的检查点, 丢弃未提交的
+    void recoverSnapshot() {
+        Manifest manifest;
+        if (!manifest.load()) return;
+        manifest.apply();
+        Manifest::discard(manifest.generation + 1);
+        generation = manifest.generation;
+        binaryCurrent = manifest.contains(SNAPSHOT_FILE);
+    }
+    
+    // 以下加载函数不加锁, 只在构造时调用
+    bool loadBinary() {
+        MappedFile file(SNAPSHOT_FILE);
+        string_view data = file.view();
+        if (data.empty()) return false;
+        PROFILE_BYTES(PROF_LOAD, data.size(), 0);
+        
+        uint64_t stored = 0;
+        if (data.size() >= sizeof(SnapshotHeader) + 8) {
+            memcpy(&stored, data.data() + data.size() - 8, 8);
+        }
+        if (stored == 0 || checksum64(data.data(), data.size() - 8) != stored) {
+            cerr << SNAPSHOT_FILE << ": 校验失败, 改为加载文本文件" << endl;
+            return false;
+        }
+        
+        SnapshotReader in(data.data(), data.size() - 8);
+        const SnapshotHeader* h = in.takeArray<SnapshotHeader>(1);
+        if (!h || memcmp(h->magic, SNAPSHOT_MAGIC, 8) != 0 ||
+            h->version != SNAPSHOT_VERSION || h->headerSize != sizeof(SnapshotHeader) ||
+            h->teacherIds + h->studentIds + h->courseIds > h->stringCount) {
+            cerr << SNAPSHOT_FILE << ": 文件头无法识别, 改为加载文本文件" << endl;
+            return false;
+        }
+        const uint64_t* offsets = in.takeArray<uint64_t>(h->stringCount + 1);
+        const char* chars = in.take(h->stringBytes);
+        const PersonRecord* trows = in.takeArray<PersonRecord>(h->teachers);
+        const PersonRecord* srows = in.takeArray<PersonRecord>(h->students);
+        const uint32_t* refs = in.takeArray<uint32_t>(h->courseRefs);
+        const CourseRecord* crows = in.takeArray<CourseRecord>(h->courses);
+        const Handle* qteacher = in.takeArray<Handle>(h->records);
+        const Handle* qstudent = in.takeArray<Handle>(h->records);
+        const Handle* qcourse = in.takeArray<Handle>(h->records);
+        const int64_t* qtime = in.takeArray<int64_t>(h->records);
+        const uint8_t* qrating = in.takeArray<uint8_t>(h->records);
+        if (!in.ok() || offsets[h->stringCount] > h->stringBytes) {
+            cerr << SNAPSHOT_FILE << ": 文件不完整, 改为加载文本文件" << endl;
+            return false;
+        }
+        for (uint64_t i = 0; i < h->stringCount; i++) {
+            if (offsets[i] > offsets[i + 1]) return false;
+        }
+        // 答疑记录的句柄越界说明文件有问题; 在修改系统之前检查, 整个快照作废, 改为加载文本文件
+        bool inRange = true;
+        for (uint64_t i = 0; i < h->records; i++) {
+            inRange &= (qteacher[i] < h->teacherIds) & (qstudent[i] < h->studentIds) &
+                       (qcourse[i] < h->courseIds);
+        }
+        if (!inRange) {
+            cerr << SNAPSHOT_FILE << ": 答疑记录引用了不存在的ID, 改为加载文本文件" << endl;
+            return false;
+        }
+        auto str = [&](uint64_t i) {
+            return string_view(chars + offsets[i], offsets[i + 1] - offsets[i]);
+        };
+        
+        // 符号表按原顺序重新驻留; 从空系统加载时换算表就是恒等映射
+        uint64_t base = 0;
+        auto internAll = [&](SymbolTable& table, uint64_t count, bool& identity) {
+            vector<Handle> map(count);
+            for (uint64_t i = 0; i < count; i++) {
+                map[i] = table.intern(str(base + i));
+                identity = identity && map[i] == i;
+            }
+            base += count;
+            return map;
+        };
+        bool identity = true;
+        vector<Handle> tmap = internAll(ids.teachers, h->teacherIds, identity);
+        vector<Handle> smap = internAll(ids.students, h->studentIds, identity);
+        vector<Handle> cmap = internAll(ids.courses, h->courseIds, identity);
+        
+        auto checked = [](const vector<Handle>& map, uint32_t h) {
+            return h < map.size() ? map[h] : NO_HANDLE;
+        };
+        auto loadPeople = [&](const PersonRecord* rows, uint64_t n, const vector<Handle>& selfMap,
+                              SymbolTable& table, auto& target) {
+            for (uint64_t i = 0; i < n; i++) {
+                const PersonRecord& r = rows[i];
+                Handle self = checked(selfMap, r.handle);
+                if (self == NO_HANDLE || r.password >= h->stringCount ||
+                    uint64_t(r.courseBegin) + r.courseCount > h->courseRefs) continue;
+                typename decay_t<decltype(target)>::value_type person(
+                    self, string(table.name(self)), string(str(r.password)));
+                vector<Handle> list;
+                for (uint32_t k = r.courseBegin; k < r.courseBegin + r.courseCount; k++) {
+                    Handle c = checked(cmap, refs[k]);
+                    if (c != NO_HANDLE) list.push_back(c);
+                }
+                person.setCourses(move(list));
+                target.put(self, move(person));
+            }
+        };
+        loadPeople(trows, h->teachers, tmap, ids.teachers, teachers);
+        loadPeople(srows, h->students, smap, ids.students, students);
+        
+        for (uint64_t i = 0; i < h->courses; i++) {
+            const CourseRecord& r = crows[i];
+            Handle c = checked(cmap, r.handle);
+            if (c == NO_HANDLE || r.name >= h->stringCount || r.time >= h->stringCount) continue;
+            CourseKind kind;
+            if (r.kind > 0xFF || !CourseKinds::fromTag(static_cast<char>(r.kind), kind)) continue;
+            courses.put(c, Course(string(ids.courses.name(c)), string(str(r.name)), string(str(r.time)), kind));
+        }
+        
+        // 答疑记录整列拷贝, 需要换算时才逐行处理
+        uint64_t n = h->records;
+        if (identity) {
+            qaStore.appendColumns(qteacher, qstudent, qcourse, qtime, qrating, n);
+        } else {
+            vector<Handle> t(n), s(n), c(n);
+            for (uint64_t i = 0; i < n; i++) {
+                t[i] = tmap[qteacher[i]];
+                s[i] = smap[qstudent[i]];
+                c[i] = cmap[qcourse[i]];
+            }
+            qaStore.appendColumns(t.data(), s.data(), c.data(), qtime, qrating, n);
+        }
+        return true;
+    }
+    
+    // 在检查点视图的读锁内把整个二进制快照组装在内存里, 由检查点线程写盘
+    string buildBinary() {
+        // 字符串表: 先是三张符号表, 再是其它字符串
+        vector<string_view> strings;
+        auto addString = [&strings](string_view text) {
+            strings.push_back(text);
+            return static_cast<uint32_t>(strings.size() - 1);
+        };
+        for (const SymbolTable* table : {&ids.teachers, &ids.students, &ids.courses}) {
+            for (Handle h = 0; h < table->size(); h++) {
+                addString(table->name(h));
+            }
+        }
+        
+        vector<uint32_t> refs;
+        auto savePerson = [&](Handle self, const string& password, const HandleSet& list) {
+            PersonRecord r = {self, addString(password), static_cast<uint32_t>(refs.size()),
+                              static_cast<uint32_t>(list.size())};
+            refs.insert(refs.end(), list.begin(), list.end());
+            return r;
+        };
+        vector<PersonRecord> trows, srows;
+        for (const auto& t : teachers) {
+            trows.push_back(savePerson(t.first, t.second.getPassword(), t.second.getCourses()));
+        }
+        for (const auto& s : students) {
+            srows.push_back(savePerson(s.first, s.second.getPassword(), s.second.getCourses()));
+        }
+        vector<CourseRecord> crows;
+        for (const auto& c : courses) {
+            crows.push_back(CourseRecord{c.first, addString(c.second.getCourseName()),
+                                         addString(c.second.getQATime()),
+                                         static_cast<uint32_t>(c.second.getTypeTag())});
+        }
+        
+        vector<uint64_t> offsets;
+        string chars;
+        for (string_view text : strings) {
+            offsets.push_back(chars.size());
+            chars.append(text);
+        }
+        offsets.push_back(chars.size());
+        
+        SnapshotHeader h = {};
+        memcpy(h.magic, SNAPSHOT_MAGIC, 8);
+        h.version = SNAPSHOT_VERSION;
+        h.headerSize = sizeof(SnapshotHeader);
+        h.teacherIds = ids.teachers.size();
+        h.studentIds = ids.students.size();
+        h.courseIds = ids.courses.size();
+        h.teachers = trows.size();
+        h.students = srows.size();
+        h.courseRefs = refs.size();
+        h.courses = crows.size();
+        h.records = qaStore.size();
+        h.stringCount = strings.size();
+        h.stringBytes = chars.size();
+        
+        SnapshotWriter out;
+        out.put(h);
+        out.putArray(offsets);
+        out.putBytes(chars.data(), chars.size());
+        out.putArray(trows);
+        out.putArray(srows);
+        out.putArray(refs);
+        out.putArray(crows);
+        auto putColumn = [&](auto column) {
+            qaStore.forEachChunk([&](const QAChunk& c, size_t n) {
+                out.append(c.*column, n * sizeof((c.*column)[0]));
+            });
+            out.pad();
+        };
+        putColumn(&QAChunk::teacher);
+        putColumn(&QAChunk::student);
+        putColumn(&QAChunk::course);
+        putColumn(&QAChunk::time);
+        putColumn(&QAChunk::rating);
+        out.put(checksum64(out.bytes().data(), out.bytes().size()));
+        return move(out.bytes());
+    }
+    
+    // 加载文本文件: 每个文件整体映射到内存, 行和字段都是指向映射区的string_view
+    void loadText() {
+        MappedFile tfile(TEACHER_FILE);
+        MappedFile sfile(STUDENT_FILE);
+        MappedFile cfile(COURSE_FILE);
+        MappedFile qfile(QA_FILE);
+        PROFILE_BYTES(PROF_LOAD, tfile.view().size() + sfile.view().size() + cfile.view().size() +
+                                 qfile.view().size(), 0);
+        
+        // 答疑记录边解析边分页, 写满的页记下文件位置后即可换出
+        qaStore.openFile(QA_FILE);
+        unsigned threads = config.loadThreads ? config.loadThreads : thread::hardware_concurrency();
+        if (threads <= 1) {
+            parseTeachers(tfile.view(), ids, [this](Teacher&& t) {
+                teachers.put(t.getHandle(), move(t));
+            });
+            parseStudents(sfile.view(), ids, [this](Student&& s) {
+                students.put(s.getHandle(), move(s));
+            });
+            parseCourses(cfile.view(), [this](Course&& c) {
+                courses.put(ids.courses.intern(c.getCourseID()), move(c));
+            });
+            size_t released = 0;
+            skippedRows += parseQARecords(qfile.view(), ids, [&](const QAInfo& qa, uint64_t begin, uint64_t end) {
+                qaStore.addFromFile(qa, begin, end);
+                if (end - released >= PARALLEL_CHUNK_BYTES) {
+                    qfile.release(end);
+                    released = end;
+                }
+            });
+        } else {
+            loadParallel(tfile, sfile, cfile, qfile, threads);
+        }
+        if (skippedRows > 0) {
+            cerr << QA_FILE << ": 跳过 " << skippedRows << " 行格式错误的记录" << endl;
+        }
+        
+        teacherText = loadedState(tfile.view());
+        studentText = loadedState(sfile.view());
+        courseText = loadedState(cfile.view());
+        // 答疑文件已随解析交还映射, 不再整体数行(行数只用于教师/学生/课程文件)
+        string_view qtext = qfile.view();
+        qaText = TextFileState();
+        qaText.known = qtext.empty() || qtext.back() == '\n';
+        qaText.bytes = qtext.size();
+        // 有跳过的行时文件行号与记录下标对不上, 不能原位改写
+        qaText.known = qaText.known && skippedRows == 0;
+        unratedRows.clear();
+        unratedOffsets.clear();
+        qaOffsetsFrom = qaStore.size();
+    }
+    
+    // 最后一行没有换行符时追加会接在它后面, 只能整体重写
+    static TextFileState loadedState(string_view text) {
+        TextFileState state;
+        state.known = text.empty() || text.back() == '\n';
+        state.bytes = text.size();
+        state.lines = count(text.begin(), text.end(), '\n');
+        return state;
+    }
+    
+    // 文本文件不再对应已提交的状态(只写了二进制快照, 或检查点失败), 下次整体重写
+    void forgetText() {
+        teacherText = studentText = courseText = qaText = TextFileState();
+    }
+    
+    // 保存数据: 按配置的格式做一次检查点; 文本格式默认只写出上次保存之后的修改, full为true时整体重写.
+    // 调用方持有checkpointLock
+    void saveData(bool full) {
+        bool text = config.format == SnapshotFormat::TEXT;
+        runCheckpoint(full, text, !text);
+    }
+    
+    // 检查点视图, 与日志中本代标记之前的记录对应. 答疑记录按切出时的行数和评分写出;
+    // 教师/学生/课程写出时分批读取, 可能带上标记之后的修改, 这些记录重放时结果不变(幂等)
+    struct CheckpointView {
+        uint64_t generation = 0;
+        uint64_t marker = 0; // 本代标记在日志中的序号
+        uint64_t qaVersion = 0; // 切出时答疑记录的版本号
+        bool full = false;
+        vector<Handle> teachers, students, courses; // 上次保存之后修改过的实体
+        vector<Handle> courseOrder;                 // 整体重写课程文件时按ID排序
+        size_t liveTeachers = 0, liveStudents = 0, liveCourses = 0;
+        size_t firstRow = 0, rows = 0;              // 上次保存之后新增的行为[firstRow, rows)
+        vector<pair<uint32_t, int>> rerated;        // 已保存的行中此后被评分的行及评分
+        string image;                               // 二进制快照
+    };
+    
+    // 在读锁内切出视图: 此时没有修改在进行, 日志中本代标记之前的记录恰好都已反映在内存中
+    CheckpointView captureView(bool full, bool binary) {
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        CheckpointView view;
+        view.generation = generation + 1;
+        view.marker = journal.mark(view.generation);
+        // 还没有提交过检查点(没有清单)时崩溃后无从截掉追加了一半的尾部, 第一次检查点整体重写到临时文件
+        view.full = full || generation == 0;
+        view.teachers = dirtyTeachers.sorted();
+        view.students = dirtyStudents.sorted();
+        view.courses = dirtyCourses.sorted();
+        dirtyTeachers.clear();
+        dirtyStudents.clear();
+        dirtyCourses.clear();
+        view.liveTeachers = teachers.size();
+        view.liveStudents = students.size();
+        view.liveCourses = courses.size();
+        for (const Course* c : sortedCourses()) {
+            view.courseOrder.push_back(ids.courses.find(c->getCourseID()));
+        }
+        view.firstRow = qaStore.persisted();
+        view.rows = qaStore.size();
+        for (uint32_t row : qaStore.rerated()) {
+            view.rerated.emplace_back(row, qaStore.at(row).rating);
+        }
+        sort(view.rerated.begin(), view.rerated.end());
+        view.qaVersion = qaStore.currentVersion();
+        qaStore.markPersisted();
+        if (binary) view.image = buildBinary();
+        return view;
+    }
+    
+    // 检查点: 切出视图后写文件, 只在分批读取内存时短暂持读锁, 前台修改不等待磁盘;
+    // 所有文件落盘后写入清单提交, 再完成改名、改写评分并压缩日志. 调用方持有checkpointLock
+    bool runCheckpoint(bool full, bool text, bool binary) {
+        PROFILE_SCOPE(PROF_SAVE);
+        CheckpointView view;
+        Manifest manifest;
+        manifest.generation = generation + 1;
+        bool ok;
+        try {
+            view = captureView(full, binary);
+            if (!text) forgetText();
+            ok = (!text || saveText(view, manifest)) && (!binary || saveBinary(view, manifest)) &&
+                 journal.commit(view.marker) && manifest.save();
+        } catch (const PageReadError& e) {
+            // 换出的答疑记录页读不回来, 不写出缺行的文件
+            cerr << e.what() << endl;
+            ok = false;
+        }
+        if (!ok) {
+            cerr << "检查点写入失败, 数据仍以上一次检查点和日志为准" << endl;
+            forgetText();
+            Manifest::discard(manifest.generation);
+            return false;
+        }
+        generation = view.generation;
+        binaryCurrent = binary;
+        manifest.apply();
+        if (text) {
+            {
+                unique_lock<shared_mutex> qaGuard(qaLock);
+                qaStore.fileCommitted(QA_FILE, qaReplaced, qaFirstPage, qaPageStarts, view.rows, qaText.bytes,
+                                      view.qaVersion);
+            }
+            qaStore.closeRetired();
+        }
+        journal.compact(generation);
+        return true;
+    }
+    
+    // 分批写出: 每批在读锁内反复调用item直到缓冲攒够或item返回false(没有更多), 释放锁后再写文件
+    template <class Item>
+    void writeBatches(OutputBuffer& out, Item item) {
+        bool more = true;
+        while (more) {
+            {
+                shared_lock<shared_mutex> entityGuard(entityLock);
+                shared_lock<shared_mutex> qaGuard(qaLock);
+                while (out.buffered() < CHECKPOINT_BATCH_BYTES && (more = item(out))) {}
+            }
+            out.flush();
+        }
+    }
+    
+    bool saveBinary(const CheckpointView& view, Manifest& manifest) {
+        string tmp = Manifest::temporary(SNAPSHOT_FILE, view.generation);
+        if (!writeFile(tmp, view.image)) return false;
+        PROFILE_BYTES(PROF_SAVE, 0, view.image.size());
+        manifest.renames.emplace_back(tmp, SNAPSHOT_FILE);
+        manifest.files.emplace_back(SNAPSHOT_FILE, view.image.size());
+        return true;
+    }
+    
+    bool saveText(const CheckpointView& view, Manifest& manifest) {
+        // 保存教师数据
+        if (!saveEntityFile(TEACHER_FILE, view.teachers, view.liveTeachers, teacherText, view.full, manifest,
+                            [&](size_t i) { return i < ids.teachers.size() ? static_cast<Handle>(i) : NO_HANDLE; },
+                            [&](OutputBuffer& out, Handle h) {
+                                const Teacher* t = teachers.find(h);
+                                if (t) t->saveToFile(out, ids.courses);
+                                return t != nullptr;
+                            })) {
+            return false;
+        }
+        
+        // 保存学生数据
+        if (!saveEntityFile(STUDENT_FILE, view.students, view.liveStudents, studentText, view.full, manifest,
+                            [&](size_t i) { return i < ids.students.size() ? static_cast<Handle>(i) : NO_HANDLE; },
+                            [&](OutputBuffer& out, Handle h) {
+                                const Student* s = students.find(h);
+                                if (s) s->saveToFile(out, ids.courses);
+                                return s != nullptr;
+                            })) {
+            return false;
+        }
+        
+        // 保存课程数据: 课程创建后不再修改, 新课程追加在末尾, 整体重写时按ID排序
+        if (!saveEntityFile(COURSE_FILE, view.courses, view.liveCourses, courseText, view.full, manifest,
+                            [&](size_t i) { return i < view.courseOrder.size() ? view.courseOrder[i] : NO_HANDLE; },
+                            [&](OutputBuffer& out, Handle h) {
+                                const Course* c = courses.find(h);
+                                if (c) c->saveToFile(out);
+                                return c != nullptr;
+                            })) {
+            return false;
+        }
+        
+        // 保存答疑记录
+        return saveRecords(view, manifest);
+    }
+    
+    // 保存一个实体文件. 文件与上次提交时一致且旧行不多于有效行时, 只把修改过的实体整行追加到末尾
+    // (读取时同一ID以最后一行为准), 否则整体写到临时文件, 提交后改名替换.
+    // 整体重写时order(i)给出第i个句柄, 没有更多时返回NO_HANDLE; order和render在读锁内调用
+    template <class Order, class Render>
+    bool saveEntityFile(const string& path, const vector<Handle>& dirty, size_t live, TextFileState& state,
+                        bool full, Manifest& manifest, Order order, Render render) {
+        bool append = !full && state.known && fileSize(path) == static_cast<int64_t>(state.bytes) &&
+                      state.lines + dirty.size() <= 2 * live;
+        if (append && dirty.empty()) {
+            manifest.files.emplace_back(path, state.bytes);
+            return true;
+        }
+        
+        string target = append ? path : Manifest::temporary(path, manifest.generation);
+        state.known = false;
+        ofstream file(target, append ? ios::app : ios::trunc);
+        if (!file) return false;
+        size_t next = 0, lines = 0;
+        uint64_t written;
+        {
+            OutputBuffer out(file);
+            writeBatches(out, [&](OutputBuffer& o) {
+                Handle h = append ? (next < dirty.size() ? dirty[next] : NO_HANDLE) : order(next);
+                if (h == NO_HANDLE) return false;
+                next++;
+                if (render(o, h)) lines++;
+                return true;
+            });
+            written = out.position();
+        }
+        file.close();
+        if (file.fail() || !syncFile(target)) return false;
+        PROFILE_BYTES(PROF_SAVE, 0, written);
+        
+        state.lines = append ? state.lines + lines : lines;
+        state.bytes = append ? state.bytes + written : written;
+        state.known = true;
+        if (!append) manifest.renames.emplace_back(target, path);
+        manifest.files.emplace_back(path, state.bytes);
+        return true;
+    }
+    
+    // 保存答疑记录: 已提交的行中此后被评分的记入清单, 提交后原位改写两位评分; 新记录追加到末尾.
+    // 文件状态未知、被改动过或找不到某行的评分字段时整体写到临时文件
+    bool saveRecords(const CheckpointView& view, Manifest& manifest) {
+        vector<pair<uint64_t, int>> patches;
+        bool append = !view.full && qaText.known && fileSize(QA_FILE) == static_cast<int64_t>(qaText.bytes) &&
+                      locateRatings(view.rerated, patches);
+        if (append) manifest.patches = move(patches);
+        qaReplaced = !append;
+        qaFirstPage = append ? (view.firstRow + QA_CHUNK_ROWS - 1) / QA_CHUNK_ROWS : 0;
+        qaPageStarts.clear();
+        if (append && view.firstRow == view.rows) {
+            manifest.files.emplace_back(QA_FILE, qaText.bytes);
+            return true;
+        }
+        
+        string target = append ? QA_FILE : Manifest::temporary(QA_FILE, view.generation);
+        if (!append) {
+            unratedRows.clear();
+            unratedOffsets.clear();
+            qaOffsetsFrom = 0;
+        }
+        qaText.known = false;
+        ofstream file(target, append ? ios::app : ios::trunc);
+        if (!file) return false;
+        uint64_t base = append ? qaText.bytes : 0;
+        uint64_t written;
+        {
+            OutputBuffer out(file);
+            appendRecords(out, append ? view.firstRow : 0, view.rows, base);
+            written = out.position();
+        }
+        file.close();
+        if (file.fail() || !syncFile(target)) return false;
+        PROFILE_BYTES(PROF_SAVE, 0, written);
+        
+        qaText.bytes = base + written;
+        qaText.known = true;
+        if (!append) manifest.renames.emplace_back(target, QA_FILE);
+        manifest.files.emplace_back(QA_FILE, qaText.bytes);
+        return true;
+    }
+    
+    // 写出[first, end)行, base为写出位置在文件中的偏移; 视图切出后才评分的行仍按未评分写出.
+    // 记下未评分行评分字段的偏移和每页首行的偏移
+    void appendRecords(OutputBuffer& out, size_t first, size_t end, uint64_t base) {
+        vector<uint32_t> later; // 视图切出后被评分的行, 即当前的rerated(), 只会增长
+        string page;
+        for (size_t i = first; i < end; ) {
+            size_t stop = min(end, (i / QA_CHUNK_ROWS + 1) * QA_CHUNK_ROWS);
+            // 换出的整页直接拷贝文件中的原文, 不必读入再逐行格式化; 它在视图切出后没有被评分
+            if (stop - i == QA_CHUNK_ROWS && qaStore.pageText(i / QA_CHUNK_ROWS, page) &&
+                copyPage(out, page, i, base)) {
+                i = stop;
+                continue;
+            }
+            {
+                // 换出的页先在答疑记录的锁外读入
+                shared_lock<shared_mutex> entityGuard(entityLock);
+                qaStore.prefetch(i / QA_CHUNK_ROWS);
+            }
+            writeBatches(out, [&](OutputBuffer& o) {
+                if (i >= stop) return false;
+                if (later.size() != qaStore.rerated().size()) {
+                    later = qaStore.rerated();
+                    sort(later.begin(), later.end());
+                }
+                QAInfo qa = qaStore.at(i);
+                if (i % QA_CHUNK_ROWS == 0) qaPageStarts.push_back(base + o.position());
+                if (qa.rating != 0 && binary_search(later.begin(), later.end(), static_cast<uint32_t>(i))) {
+                    qa.rating = 0;
+                }
+                qa.saveToFile(o, ids);
+                if (qa.rating == 0) {
+                    unratedRows.push_back(static_cast<uint32_t>(i));
+                    unratedOffsets.push_back(base + o.position() - 3); // 行尾为"00\n"
+                }
+                i++;
+                return true;
+            });
+        }
+    }
+    
+    // 写出换出页的原文, 须恰好是一整页的行; 评分字段按格式化的写法写出(原位改写留下的"07"写成"7").
+    // 记下"00"评分字段的偏移和页首偏移
+    bool copyPage(OutputBuffer& out, string_view text, size_t first, uint64_t base) {
+        string_view rest = text, line;
+        size_t n = 0;
+        while (nextLine(rest, line)) {
+            if (line.empty() || line.find('|') == string_view::npos) return false;
+            n++;
+        }
+        if (n != QA_CHUNK_ROWS || text.back() != '\n') return false;
+        qaPageStarts.push_back(base + out.position());
+        rest = text;
+        for (size_t r = 0; nextLine(rest, line); r++) {
+            size_t bar = line.rfind('|') + 1;
+            int rating = parseInt(line.substr(bar));
+            out << line.substr(0, bar);
+            if (rating == 0) {
+                unratedRows.push_back(static_cast<uint32_t>(first + r));
+                unratedOffsets.push_back(base + out.position());
+                out << "00";
+            } else {
+                out << rating;
+            }
+            out << '\n';
+        }
+        out.flush();
+        return true;
+    }
+    
+    // 找出各行评分字段在文件中的偏移
+    bool locateRatings(const vector<pair<uint32_t, int>>& rerated, vector<pair<uint64_t, int>>& patches) {
+        if (!rerated.empty() && rerated.front().first < qaOffsetsFrom && !scanUnratedOffsets()) return false;
+        for (const auto& r : rerated) {
+            auto it = lower_bound(unratedRows.begin(), unratedRows.end(), r.first);
+            if (it == unratedRows.end() || *it != r.first) return false;
+            patches.emplace_back(unratedOffsets[it - unratedRows.begin()], r.second);
+        }
+        return true;
+    }
+    
+    // 从文本加载的记录没有偏移, 第一次需要原位改写时扫描文件补上; 只认两位的"00"
+    bool scanUnratedOffsets() {
+        MappedFile file(QA_FILE);
+        string_view text = file.view();
+        string_view rest = text, line;
+        vector<uint32_t> rows;
+        vector<uint64_t> offsets;
+        uint32_t row = 0;
+        while (row < qaOffsetsFrom && nextLine(rest, line)) {
+            if (line.empty()) continue;
+            size_t bar = line.rfind('|');
+            if (bar != string_view::npos && line.substr(bar + 1) == "00") {
+                rows.push_back(row);
+                offsets.push_back(line.data() + bar + 1 - text.data());
+            }
+            row++;
+        }
+        if (row < qaOffsetsFrom) return false;
+        rows.insert(rows.end(), unratedRows.begin(), unratedRows.end());
+        offsets.insert(offsets.end(), unratedOffsets.begin(), unratedOffsets.end());
+        unratedRows.swap(rows);
+        unratedOffsets.swap(offsets);
+        qaOffsetsFrom = 0;
+        return true;
+    }
+    
+    // 修改的结果: 没有修改; 已修改且日志已落盘; 内存已修改但日志写入或落盘失败, 重启后会丢失
+    enum Applied { UNCHANGED, DURABLE, NOT_DURABLE };
+    
+    // 按修改结果选提示; 日志失败时不提示成功
+    static const char* outcome(Applied result, const char* done, const char* unchanged) {
+        if (result == NOT_DURABLE) return "修改未能写入日志, 重启后将会丢失!";
+        return result == DURABLE ? done : unchanged;
+    }
+    
+    // 执行要读答疑记录页的命令; 页读不回来时向out(流或OutputBuffer)提示并返回false, 已输出的部分不完整
+    template <class Out, class F>
+    static bool readingRecords(Out& out, F command) {
+        try {
+            command();
+            return true;
+        } catch (const PageReadError& e) {
+            out << e.what() << '\n';
+            return false;
+        }
+    }
+    
+    // 修改教师/学生/课程: 在写锁内执行change并追加日志, 释放锁后等待落盘
+    // change返回日志记录, 返回空串表示没有修改
+    template <class F>
+    Applied applyEntities(F change) {
+        uint64_t seq;
+        {
+            unique_lock<shared_mutex> guard(entityLock);
+            string record = change();
+            if (record.empty()) return UNCHANGED;
+            seq = journal.append(record);
+        }
+        return commitRecord(seq) ? DURABLE : NOT_DURABLE;
+    }
+    
+    // 修改答疑记录: 教师/学生/课程只读, 答疑记录取写锁
+    template <class F>
+    Applied applyRecords(F change) {
+        uint64_t seq;
+        {
+            shared_lock<shared_mutex> entityGuard(entityLock);
+            unique_lock<shared_mutex> qaGuard(qaLock);
+            string record = change();
+            if (record.empty()) return UNCHANGED;
+            seq = journal.append(record);
+        }
+        return commitRecord(seq) ? DURABLE : NOT_DURABLE;
+    }
+    
+public:
+    // 把已追加的日志一次写出并落盘(deferCommit模式下由调用方定期调用), 写入或落盘失败时返回false
+    bool commitPending() {
+        return journal.commit();
+    }
+    
+    // full为true时整体重写快照, 不做增量保存
+    void checkpoint(bool full = false) {
+        lock_guard<mutex> single(checkpointLock);
+        saveData(full);
+    }
+    
+    // 用户认证, 新ID自动注册; 密码错误返回nullptr.
+    // 读锁内只取出存储的密码, 散列校验在锁外进行, 不阻塞其它会话的修改
+    Teacher* authenticateTeacher(string id, string pwd) {
+        PROFILE_SCOPE(PROF_AUTH);
+        Teacher* t;
+        string stored;
+        {
+            shared_lock<shared_mutex> guard(entityLock);
+            t = findTeacher(id);
+            if (t) stored = t->getPassword();
+        }
+        if (!t) {
+            // 新教师注册: 先在锁外算好散列, 取写锁后重新查找, 其它会话可能刚注册了同一ID
+            string hashed = credentials.hash(pwd);
+            bool registered = applyEntities([&] {
+                t = findTeacher(id);
+                if (t) {
+                    stored = t->getPassword();
+                    return string();
+                }
+                t = &registerTeacher(id, hashed);
+                return "TN|" + id + "|" + hashed;
+            }) != UNCHANGED;
+            if (registered) {
+                credentials.remember(CredentialService::userKey(false, t->getHandle()), hashed, pwd);
+                return t;
+            }
+        }
+        if (!credentials.verify(CredentialService::userKey(false, t->getHandle()), stored, pwd)) return nullptr;
+        if (!PasswordHash::isHashed(stored)) upgradePassword(t, stored, pwd);
+        return t;
+    }
+    
+    Student* authenticateStudent(string id, string pwd) {
+        PROFILE_SCOPE(PROF_AUTH);
+        Student* s;
+        string stored;
+        {
+            shared_lock<shared_mutex> guard(entityLock);
+            s = findStudent(id);
+            if (s) stored = s->getPassword();
+        }
+        if (!s) {
+            // 新学生注册
+            string hashed = credentials.hash(pwd);
+            bool registered = applyEntities([&] {
+                s = findStudent(id);
+                if (s) {
+                    stored = s->getPassword();
+                    return string();
+                }
+                s = &registerStudent(id, hashed);
+                return "SN|" + id + "|" + hashed;
+            }) != UNCHANGED;
+            if (registered) {
+                credentials.remember(CredentialService::userKey(true, s->getHandle()), hashed, pwd);
+                return s;
+            }
+        }
+        if (!credentials.verify(CredentialService::userKey(true, s->getHandle()), stored, pwd)) return nullptr;
+        if (!PasswordHash::isHashed(stored)) upgradePassword(s, stored, pwd);
+        return s;
+    }
+    
+    // 清空登录会话缓存, 之后每个用户的首次认证重新计算散列
+    void clearSessions() {
+        credentials.clearSessions();
+    }
+    
+    size_t authThreads() const {
+        return credentials.threads();
+    }
+    
+    // 课程表中所有课程号, 按课程号排序
+    vector<string> courseIDs() const {
+        shared_lock<shared_mutex> guard(entityLock);
+        vector<string> result;
+        result.reserve(courseOrder.size());
+        for (const Course* c : courseOrder) result.push_back(c->getCourseID());
+        return result;
+    }
+    
+    // 所有学生的学号, 按句柄(首次出现)顺序
+    vector<string> studentIDs() const {
+        shared_lock<shared_mutex> guard(entityLock);
+        vector<string> result;
+        result.reserve(students.size());
+        for (const auto& s : students) result.push_back(s.second.getID());
+        return result;
+    }
+    
+    // 新密码在锁外算好散列, 日志和快照中只保存散列
+    bool changePassword(Teacher* t, string pwd, ostream& out = cout) {
+        if (!t) return false;
+        string hashed = credentials.hash(pwd);
+        Applied result = applyEntities([&] {
+            t->setPassword(hashed);
+            dirtyTeachers.mark(t->getHandle());
+            return "TP|" + t->getID() + "|" + hashed;
+        });
+        credentials.remember(CredentialService::userKey(false, t->getHandle()), hashed, pwd);
+        out << outcome(result, "密码修改成功!", "") << '\n';
+        return result == DURABLE;
+    }
+    
+    bool changePassword(Student* s, string pwd, ostream& out = cout) {
+        if (!s) return false;
+        string hashed = credentials.hash(pwd);
+        Applied result = applyEntities([&] {
+            s->setPassword(hashed);
+            dirtyStudents.mark(s->getHandle());
+            return "SP|" + s->getID() + "|" + hashed;
+        });
+        credentials.remember(CredentialService::userKey(true, s->getHandle()), hashed, pwd);
+        out << outcome(result, "密码修改成功!", "") << '\n';
+        return result == DURABLE;
+    }
+    
+    // 课程管理
+    bool addNewCourse(string id, string name, string time, string type, ostream& out = cout) {
+        CourseKind kind;
+        string tag = CourseKinds::fromName(type, kind) ? string(1, CourseKinds::tagOf(kind)) : "";
+        const char* error = nullptr;
+        Applied result = applyEntities([&] {
+            if (courses.find(ids.courses.find(id))) {
+                error = "课程ID已存在!";
+                return string();
+            }
+            if (tag.empty()) {
+                error = "无效的课程类型!";
+                return string();
+            }
+            createCourse(id, name, time, tag);
+            return "NC|" + id + "|" + name + "|" + time + "|" + tag;
+        });
+        out << outcome(result, "课程创建成功!", error) << '\n';
+        return result == DURABLE;
+    }
+    
+    bool addTeacherCourse(Teacher* t, string cid, ostream& out = cout) {
+        if (!t) return false;
+        Applied result = applyEntities([&] {
+            Handle c = ids.courses.intern(cid);
+            if (!t->addCourse(c)) return string();
+            slotOf(teaching, c).insert(t->getHandle());
+            dirtyTeachers.mark(t->getHandle());
+            return "TA|" + t->getID() + "|" + cid;
+        });
+        out << outcome(result, "课程添加成功!", "该课程已存在!") << '\n';
+        return result == DURABLE;
+    }
+    
+    bool deleteTeacherCourse(Teacher* t, string cid, ostream& out = cout) {
+        if (!t) return false;
+        Applied result = applyEntities([&] {
+            Handle c = ids.courses.find(cid);
+            if (!t->deleteCourse(c)) return string();
+            slotOf(teaching, c).erase(t->getHandle());
+            dirtyTeachers.mark(t->getHandle());
+            return "TD|" + t->getID() + "|" + cid;
+        });
+        out << outcome(result, "课程删除成功!", "未找到该课程!") << '\n';
+        return result == DURABLE;
+    }
+    
+    bool selectCourse(Student* s, string cid, ostream& out = cout) {
+        if (!s) return false;
+        Applied result = applyEntities([&] {
+            Handle c = ids.courses.intern(cid);
+            if (!s->selectCourse(c)) return string();
+            slotOf(enrolled, c).insert(s->getHandle());
+            dirtyStudents.mark(s->getHandle());
+            return "SA|" + s->getID() + "|" + cid;
+        });
+        out << outcome(result, "课程选修成功!", "该课程已选修!") << '\n';
+        return result == DURABLE;
+    }
+    
+    // 批量导入: 整批对照课程表和用户表校验后按句柄排序去重, 在一次加锁内并入课程名单、反向索引和答疑记录,
+    // 每项实际修改照常记一条日志(重放结果与逐条操作相同), 只返回汇总, 不逐项输出.
+    // 课程必须已在课程表中, 教师和学生必须已注册; 答疑记录在本批选课和授课并入之后校验
+    ImportSummary importBulk(const ImportBatch& batch) {
+        ImportSummary summary;
+        // 先在读锁内把ID换成句柄; 表项和课程都不会删除, 句柄在取写锁后仍然有效
+        vector<uint64_t> enrollPairs, assignPairs; // 人<<32|课程
+        struct Row {
+            int64_t time;
+            Handle teacher, student, course;
+            int rating;
+            bool operator<(const Row& o) const {
+                return tie(time, teacher, student, course, rating) <
+                       tie(o.time, o.teacher, o.student, o.course, o.rating);
+            }
+            bool operator==(const Row& o) const {
+                return time == o.time && teacher == o.teacher && student == o.student &&
+                       course == o.course && rating == o.rating;
+            }
+        };
+        vector<Row> rows;
+        {
+            shared_lock<shared_mutex> guard(entityLock);
+            auto course = [&](const string& cid) {
+                Handle c = ids.courses.find(cid);
+                if (courses.find(c)) return c;
+                summary.unknownCourses++;
+                return NO_HANDLE;
+            };
+            // 只出现在答疑记录里的ID在符号表中有句柄, 但没有注册, 表中查不到
+            auto registered = [](const auto& table, const SymbolTable& people, const string& id) {
+                Handle h = people.find(id);
+                return table.find(h) ? h : NO_HANDLE;
+            };
+            auto resolve = [&](const vector<pair<string, string>>& list, const auto& table,
+                               const SymbolTable& people, vector<uint64_t>& out) {
+                out.reserve(list.size());
+                for (const auto& item : list) {
+                    Handle c = course(item.second);
+                    if (c == NO_HANDLE) continue;
+                    Handle h = registered(table, people, item.first);
+                    if (h == NO_HANDLE) summary.unknownUsers++;
+                    else out.push_back(uint64_t(h) << 32 | c);
+                }
+            };
+            resolve(batch.enrollments, students, ids.students, enrollPairs);
+            resolve(batch.assignments, teachers, ids.teachers, assignPairs);
+            rows.reserve(batch.records.size());
+            for (const auto& r : batch.records) {
+                Handle c = course(r.course);
+                if (c == NO_HANDLE) continue;
+                Handle t = registered(teachers, ids.teachers, r.teacher);
+                Handle st = registered(students, ids.students, r.student);
+                if (t == NO_HANDLE || st == NO_HANDLE) summary.unknownUsers++;
+                else if (r.rating < 0 || r.rating > 10) summary.rejected++;
+                else rows.push_back(Row{r.time, t, st, c, r.rating});
+            }
+        }
+        // 去重: 选课和授课按(人, 课程)排序, 答疑记录按时间排序, 并入后文件中也大致按时间排列
+        auto dedupe = [&summary](auto& list) {
+            sort(list.begin(), list.end());
+            size_t before = list.size();
+            list.erase(unique(list.begin(), list.end()), list.end());
+            summary.duplicates += before - list.size();
+        };
+        dedupe(enrollPairs);
+        dedupe(assignPairs);
+        dedupe(rows);
+        
+        uint64_t seq = 0;
+        bool changed = false;
+        {
+            unique_lock<shared_mutex> entityGuard(entityLock);
+            unique_lock<shared_mutex> qaGuard(qaLock);
+            string record; // 日志记录逐条拼在同一缓冲区里
+            auto log = [&] {
+                seq = journal.append(record);
+                changed = true;
+            };
+            // 每人一段, 滤掉已有的课程后一趟归并进名单; 新增的(课程, 人)再按课程归并进反向索引
+            auto merge = [&](const vector<uint64_t>& list, auto& table, auto addCourses, vector<HandleSet>& index,
+                             DirtySet& dirty, const SymbolTable& people, const char* op) {
+                vector<uint64_t> added;
+                vector<Handle> fresh;
+                for (size_t i = 0; i < list.size();) {
+                    Handle h = Handle(list[i] >> 32);
+                    auto* person = table.find(h);
+                    fresh.clear();
+                    for (; i < list.size() && Handle(list[i] >> 32) == h; i++) {
+                        Handle c = Handle(list[i]);
+                        if (person->hasCourse(c)) continue;
+                        fresh.push_back(c);
+                        added.push_back(uint64_t(c) << 32 | h);
+                        record.assign(op).append("|").append(people.name(h)).append("|").append(ids.courses.name(c));
+                        log();
+                    }
+                    if (fresh.empty()) continue;
+                    (person->*addCourses)(fresh);
+                    dirty.mark(h);
+                }
+                sort(added.begin(), added.end());
+                for (size_t i = 0; i < added.size();) {
+                    Handle c = Handle(added[i] >> 32);
+                    fresh.clear();
+                    for (; i < added.size() && Handle(added[i] >> 32) == c; i++) fresh.push_back(Handle(added[i]));
+                    slotOf(index, c).merge(fresh.data(), fresh.data() + fresh.size());
+                }
+                summary.duplicates += list.size() - added.size();
+                return added.size();
+            };
+            summary.enrollments = merge(enrollPairs, students, &Student::selectCourses,
+                                        enrolled, dirtyStudents, ids.students, "SA");
+            summary.assignments = merge(assignPairs, teachers, &Teacher::addCourses,
+                                        teaching, dirtyTeachers, ids.teachers, "TA");
+            
+            // 答疑记录整列追加, 与加载二进制快照走同一路径
+            vector<Handle> tcol, scol, ccol;
+            vector<int64_t> timecol;
+            vector<uint8_t> ratingcol;
+            for (const Row& r : rows) {
+                if (!teachers.find(r.teacher)->hasCourse(r.course) || !students.find(r.student)->hasCourse(r.course)) {
+                    summary.rejected++;
+                    continue;
+                }
+                tcol.push_back(r.teacher);
+                scol.push_back(r.student);
+                ccol.push_back(r.course);
+                timecol.push_back(r.time);
+                ratingcol.push_back(static_cast<uint8_t>(r.rating));
+                char time[TIME_TEXT_SIZE];
+                formatTime(r.time, time);
+                record.assign("Q|").append(ids.teachers.name(r.teacher)).append("|").append(ids.students.name(r.student));
+                record.append("|").append(ids.courses.name(r.course)).append("|").append(time);
+                record.append("|").append(to_string(r.rating));
+                log();
+            }
+            qaStore.appendColumns(tcol.data(), scol.data(), ccol.data(), timecol.data(), ratingcol.data(), tcol.size());
+            summary.records = tcol.size();
+        }
+        if (changed) summary.durable = commitRecord(seq);
+        return summary;
+    }
+    
+    bool unselectCourse(Student* s, string cid, ostream& out = cout) {
+        if (!s) return false;
+        Applied result = applyEntities([&] {
+            Handle c = ids.courses.find(cid);
+            if (!s->unselectCourse(c)) return string();
+            slotOf(enrolled, c).erase(s->getHandle());
+            dirtyStudents.mark(s->getHandle());
+            return "SD|" + s->getID() + "|" + cid;
+        });
+        out << outcome(result, "课程退选成功!", "未找到该课程!") << '\n';
+        return result == DURABLE;
+    }
+    
+    void searchCourses(const Teacher* t, ostream& out = cout) const {
+        shared_lock<shared_mutex> guard(entityLock);
+        if (t) t->searchCourses(ids.courses, out);
+    }
+    
+    void searchCourses(const Student* s, ostream& out = cout) const {
+        shared_lock<shared_mutex> guard(entityLock);
+        if (s) s->searchCourses(ids.courses, out);
+    }
+    
+    // 名单查询直接取反向索引, 耗时与结果人数成正比
+    vector<string> enrolledStudents(const string& cid) const {
+        shared_lock<shared_mutex> guard(entityLock);
+        return namesIn(enrolled, ids.students, cid);
+    }
+    
+    vector<string> courseTeachers(const string& cid) const {
+        shared_lock<shared_mutex> guard(entityLock);
+        return namesIn(teaching, ids.teachers, cid);
+    }
+    
+    // 授课负担: 教师所教课程数和这些课程的选课总人次
+    pair<size_t, size_t> teachingLoad(const Teacher* t) const {
+        shared_lock<shared_mutex> guard(entityLock);
+        pair<size_t, size_t> load(0, 0);
+        if (!t) return load;
+        for (Handle c : t->getCourses()) {
+            load.first++;
+            if (c < enrolled.size()) load.second += enrolled[c].size();
+        }
+        return load;
+    }
+    
+    // 课程名单: 授课教师和选课学生, 按ID排序
+    void showCourseRoster(const string& cid, ostream& out = cout) const {
+        OutputBuffer buf(out);
+        const Course* course = getCourse(cid);
+        if (!course) {
+            buf << "未找到该课程!" << '\n';
+            return;
+        }
+        vector<string> tlist = courseTeachers(cid);
+        vector<string> slist = enrolledStudents(cid);
+        sort(tlist.begin(), tlist.end());
+        sort(slist.begin(), slist.end());
+        buf << "课程: " << cid << " " << course->getCourseName() << '\n';
+        buf << "授课教师(" << tlist.size() << "):";
+        for (const string& id : tlist) buf << " " << id;
+        buf << '\n' << "选课学生(" << slist.size() << "):";
+        for (const string& id : slist) buf << " " << id;
+        buf << '\n';
+    }
+    
+    // 课程创建后不再修改也不会删除, 返回的指针可以在锁外使用
+    const Course* getCourse(string id) const {
+        shared_lock<shared_mutex> guard(entityLock);
+        return courses.find(ids.courses.find(id));
+    }
+    
+    void displayAllCourses(ostream& out = cout) const {
+        OutputBuffer buf(out);
+        shared_lock<shared_mutex> guard(entityLock);
+        if (courses.empty()) {
+            buf << "暂无课程信息!" << '\n';
+            return;
+        }
+        buf << "==============================================" << '\n';
+        buf << "                 所有课程信息                 " << '\n';
+        buf << "==============================================" << '\n';
+        for (const Course* c : sortedCourses()) {
+            c->showMe(buf);
+        }
+        buf << "==============================================" << '\n';
+    }
+    
+    // 答疑管理
+    bool addQA(Teacher* t, string sid, string cid, ostream& out = cout) {
+        if (!t) return false;
+        PROFILE_SCOPE(PROF_ADD_QA);
+        int64_t time = getCurrentTime();
+        const char* error = nullptr;
+        Applied result = applyRecords([&] {
+            // 检查教师是否教授该课程
+            Handle course = ids.courses.find(cid);
+            if (course == NO_HANDLE || !t->hasCourse(course)) {
+                error = "您不教授此课程!";
+                return string();
+            }
+            
+            // 检查学生是否选修该课程
+            Student* student = findStudent(sid);
+            if (!student) {
+                error = "学生不存在!";
+                return string();
+            }
+            if (!student->hasCourse(course)) {
+                error = "该学生未选修此课程!";
+                return string();
+            }
+            
+            qaStore.add(QAInfo(t->getHandle(), student->getHandle(), course, time, 0));
+            return "Q|" + t->getID() + "|" + sid + "|" + cid + "|" + formatTime(time);
+        });
+        out << outcome(result, "答疑记录添加成功!", error) << '\n';
+        return result == DURABLE;
+    }
+    
+    // 交互式评分: 先确认有未评分记录, 再从标准输入读取分数
+    void rateQA(Student* s, string tid, string cid) {
+        if (!s) return;
+        
+        // 查找未评分的答疑记录
+        bool found;
+        {
+            shared_lock<shared_mutex> entityGuard(entityLock);
+            shared_lock<shared_mutex> qaGuard(qaLock);
+            found = qaStore.hasUnrated(s->getHandle(), ids.teachers.find(tid), ids.courses.find(cid));
+        }
+        if (!found) {
+            cout << "未找到可评分的答疑记录!" << '\n';
+            return;
+        }
+        
+        int rating;
+        do {
+            cout << "请为本次答疑评分(1-10): ";
+            cin >> rating;
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');//清空缓冲区
+        } while (rating < 1 || rating > 10);
+        
+        rateQA(s, tid, cid, rating);
+    }
+    
+    // 评分(1-10); 读入分数期间记录可能已被其它会话评掉, 这里重新查找
+    bool rateQA(Student* s, string tid, string cid, int rating, ostream& out = cout) {
+        if (!s) return false;
+        PROFILE_SCOPE(PROF_RATE_QA);
+        if (rating < 1 || rating > 10) {
+            out << "无效的评分!" << '\n';
+            return false;
+        }
+        Applied result = UNCHANGED;
+        bool read = readingRecords(out, [&] {
+            result = applyRecords([&] {
+                if (!qaStore.rate(s->getHandle(), ids.teachers.find(tid), ids.courses.find(cid), rating)) {
+                    return string();
+                }
+                return "R|" + tid + "|" + s->getID() + "|" + cid + "|" + to_string(rating);
+            });
+        });
+        if (!read) return false;
+        out << outcome(result, "评分成功!", "未找到可评分的答疑记录!") << '\n';
+        return result == DURABLE;
+    }
+    
+    // 教师的答疑记录条数和评分统计
+    size_t countQARecords(const Teacher* t) const {
+        shared_lock<shared_mutex> guard(qaLock);
+        return t ? qaStore.teacherRecordCount(t->getHandle()) : 0;
+    }
+    
+    RatingStats teacherStats(const Teacher* t) const {
+        shared_lock<shared_mutex> guard(qaLock);
+        return t ? qaStore.teacherAggregate(t->getHandle()) : RatingStats();
+    }
+    
+    RatingStats teacherStats(const string& tid) const {
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        return qaStore.teacherAggregate(ids.teachers.find(tid));
+    }
+    
+    RatingStats courseStats(const string& cid) const {
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        return qaStore.courseAggregate(ids.courses.find(cid));
+    }
+    
+    // 以全表重算校验增量评分统计, bad为不一致的教师和课程数; 答疑记录页读不回来时无法校验, 返回false
+    bool checkRatingAggregates(size_t& bad, ostream& out = cout) const {
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        return readingRecords(out, [&] { bad = qaStore.checkAggregates(); });
+    }
+    
+    // 所有教师的答疑次数和平均分, 按工号输出; 只读增量统计, 不扫描记录
+    void showRatingBoard(ostream& out = cout) const {
+        OutputBuffer buf(out);
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        vector<const Teacher*> sorted;
+        for (const auto& entry : teachers) sorted.push_back(&entry.second);
+        sort(sorted.begin(), sorted.end(), [](const Teacher* a, const Teacher* b) {
+            return a->getID() < b->getID();
+        });
+        for (const Teacher* teacher : sorted) {
+            const RatingStats& st = qaStore.teacherAggregate(teacher->getHandle());
+            buf << "教师: " << teacher->getID() << ", 答疑: " << st.hist[0] + st.count()
+                << " 次, 已评分: " << st.count();
+            if (st.count()) {
+                buf << ", 平均分: " << Decimal{st.average(), 1};
+            }
+            buf << '\n';
+        }
+    }
+    
+    void showRatings(const Teacher* t, ostream& out = cout) const {
+        if (!t) return;
+        if (countQARecords(t) == 0) {
+            out << "暂无答疑记录!" << '\n';
+            return;
+        }
+        
+        RatingStats st = teacherStats(t);
+        if (st.count() == 0) {
+            out << "暂无评分记录!" << '\n';
+            return;
+        }
+        
+        OutputBuffer buf(out);
+        buf << "评分统计: "
+            << "最高分: " << st.max() << ", "
+            << "最低分: " << st.min() << ", "
+            << "平均分: " << Decimal{st.average(), 1} << '\n';
+    }
+    
+    // 按添加顺序输出第first条起(从0计)的至多limit条记录, 默认全部; 边格式化边分块写出.
+    // 答疑记录页读不回来时返回false
+    bool displayQARecords(const Teacher* t, ostream& out = cout,
+                          size_t first = 0, size_t limit = numeric_limits<size_t>::max()) const {
+        if (!t) return false;
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        OutputBuffer buf(out);
+        size_t total = qaStore.teacherRecordCount(t->getHandle());
+        if (total == 0) {
+            buf << "暂无答疑记录!" << '\n';
+            return true;
+        }
+        if (first >= total) {
+            buf << "共 " << total << " 条答疑记录, 没有更多了!" << '\n';
+            return true;
+        }
+        
+        size_t last = first + min(limit, total - first);
+        if (first == 0 && last == total) {
+            buf << "答疑记录:" << '\n';
+        } else {
+            buf << "答疑记录(第 " << first + 1 << "-" << last << " 条, 共 " << total << " 条):" << '\n';
+        }
+        size_t seen = 0;
+        return readingRecords(buf, [&] {
+            qaStore.forEachTeacherRecord(t->getHandle(), [&](size_t idx) {
+                if (seen >= first) qaStore.at(idx).display(ids, buf);
+                return ++seen < last;
+            });
+        });
+    }
+    
+    // 时间窗[from, to)内某位教师/学生/某门课程的答疑记录, 只扫描时间范围相交的记录页;
+    // 答疑记录页读不回来时抛出PageReadError
+    vector<QAInfo> queryQARecords(QAStore::Filter filter, const string& id, int64_t from, int64_t to) const {
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        const SymbolTable& table = filter == QAStore::BY_TEACHER ? ids.teachers :
+                                   filter == QAStore::BY_STUDENT ? ids.students : ids.courses;
+        vector<QAInfo> result;
+        Handle key = table.find(id);
+        if (key == NO_HANDLE) return result;
+        for (size_t idx : qaStore.recordsInWindow(filter, key, from, to)) {
+            result.push_back(qaStore.at(idx));
+        }
+        return result;
+    }
+    
+    bool showQAHistory(QAStore::Filter filter, const string& id, int64_t from, int64_t to,
+                       ostream& out = cout) const {
+        OutputBuffer buf(out);
+        vector<QAInfo> records;
+        if (!readingRecords(buf, [&] { records = queryQARecords(filter, id, from, to); })) return false;
+        if (records.empty()) {
+            buf << "该时间段内暂无答疑记录!" << '\n';
+            return true;
+        }
+        
+        RatingStats st;
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        buf << "答疑记录(" << Timestamp{from} << " 至 " << Timestamp{to} << "):" << '\n';
+        for (const QAInfo& qa : records) {
+            qa.display(ids, buf);
+            if (qa.rating >= 1 && qa.rating <= 10) st.hist[qa.rating]++;
+        }
+        buf << "共 " << records.size() << " 条, 已评分 " << st.count() << " 条";
+        if (st.count()) {
+            buf << ", 平均分: " << Decimal{st.average(), 1};
+        }
+        buf << '\n';
+        return true;
+    }
+    
+    // 学期报表: 时间窗内各教师的答疑次数和评分统计, 按工号输出; 答疑记录页读不回来时返回false
+    bool showTermReport(int64_t from, int64_t to, ostream& out = cout) const {
+        OutputBuffer buf(out);
+        shared_lock<shared_mutex> entityGuard(entityLock);
+        shared_lock<shared_mutex> qaGuard(qaLock);
+        vector<RatingStats> groups;
+        if (!readingRecords(buf, [&] {
+                groups = qaStore.statsGrouped(QAStore::BY_TEACHER, ids.teachers.size(), from, to);
+            })) {
+            return false;
+        }
+        
+        buf << "学期报表(" << Timestamp{from} << " 至 " << Timestamp{to} << "):" << '\n';
+        vector<const Teacher*> active;
+        for (const auto& [handle, teacher] : teachers) {
+            const RatingStats& st = groups[handle];
+            if (st.hist[0] + st.count() > 0) active.push_back(&teacher);
+        }
+        if (active.empty()) {
+            buf << "该时间段内暂无答疑记录!" << '\n';
+            return true;
+        }
+        sort(active.begin(), active.end(), [](const Teacher* a, const Teacher* b) {
+            return a->getID() < b->getID();
+        });
+        for (const Teacher* teacher : active) {
+            const RatingStats& st = groups[teacher->getHandle()];
+            uint64_t sessions = st.hist[0] + st.count();
+            buf << "教师: " << teacher->getID() << ", 答疑: " << sessions << " 次, 已评分: " << st.count();
+            if (st.count()) {
+                buf << ", 最高分: " << st.max() << ", 最低分: " << st.min()
+                    << ", 平均分: " << Decimal{st.average(), 1};
+            }
+            buf << '\n';
+        }
+        return true;
+    }
+};
+
+// 用户界面函数
+void teacherMenu(Teacher* teacher, ManagementSystem& system);
+void studentMenu(Student* student, ManagementSystem& system);
+
+// 初始化系统数据, 仅在首次运行(没有数据文件)时写入示例数据
+void initializeSystemData() {
+    if (ifstream(TEACHER_FILE) || ifstream(SNAPSHOT_FILE)) return;
+    
+    // 创建示例教师
+    ofstream tfile(TEACHER_FILE);
+    if (tfile) {
+        tfile << "T001|pass123|C101,C102\n";
+        tfile << "T002|pass456|C201,C203\n";
+        tfile << "T003|pass124|C301,C303\n";
+        tfile << "T004|pass135|C201,C203\n";
+        tfile << "T005|pass147|C201,C203\n";
+        tfile.close();
+    }
+    
+    // 创建示例学生
+    ofstream sfile(STUDENT_FILE);
+    if (sfile) {
+        sfile << "S1001|pass789|C101,C201\n";
+        sfile << "S1002|pass123|C102,C203\n";
+        sfile << "S1003|pass456|C302,C301\n";
+        sfile << "S1004|pass567|C302,C202\n";
+        sfile << "S1005|pass678|C303,C101\n";
+        sfile.close();
+    }
+    
+    // 创建示例课程
+    ofstream cfile(COURSE_FILE);
+    if (cfile) {
+        cfile << "C101|高等数学|周一 14:00-16:00|B\n";
+        cfile << "C102|计算机基础|周三 10:00-12:00|X\n";
+        cfile << "C201|大学英语|周二 09:00-11:00|B\n";
+        cfile << "C202|数据结构|周四 15:00-17:00|B\n";
+        cfile << "C203|操作系统|周四 15:00-17:00|B\n";
+        cfile << "C301|计算机组成原理|周四 15:00-17:00|B\n";
+        cfile << "C302|电影美学|周四 15:00-17:00|X\n";
+        cfile << "C303|改革开放史|周四 15:00-17:00|X\n";
+        cfile.close();
+    }
+}
+
+// 测试数据规模, 由--gen的参数设置
+struct DatasetSpec {
+    size_t teachers = 10000;
+    size_t students = 500000;
+    size_t courses = 2000;
+    size_t records = 5000000;
+    double skew = 1.0;  // 课程热度的Zipf指数, 0表示均匀
+    uint32_t seed = 1;
+};
+
+// Zipf分布抽样: 第k个(从0起)被抽中的概率正比于1/(k+1)^s, 在累积分布上二分查找
+class ZipfSampler {
+private:
+    vector<double> cdf;
+
+public:
+    ZipfSampler(size_t n, double s) : cdf(n) {
+        double total = 0;
+        for (size_t k = 0; k < n; k++) {
+            total += 1.0 / pow(static_cast<double>(k + 1), s);
+            cdf[k] = total;
+        }
+    }
+    
+    template <class R>
+    size_t operator()(R& rng) const {
+        double u = uniform_real_distribution<double>(0, cdf.back())(rng);
+        return min<size_t>(upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), cdf.size() - 1);
+    }
+};
+
+// 生成测试数据, 覆盖当前目录的四个.dat文件并删除旧的日志和二进制快照.
+// 课程热度服从Zipf分布: 热门课程教师多、选课学生多、答疑记录也多.
+// 答疑记录的教师和学生都取自该课程的授课教师和选课学生, 时间按行递增, 约四分之一未评分
+int generateDataset(const DatasetSpec& spec) {
+    if (spec.teachers == 0 || spec.students == 0 || spec.courses == 0) {
+        cerr << "教师、学生和课程数都必须大于0" << endl;
+        return 1;
+    }
+    mt19937_64 rng(spec.seed);
+    ZipfSampler popular(spec.courses, spec.skew);
+    auto pick = [&rng](size_t n) { return static_cast<size_t>(rng() % n); };
+    auto makeId = [](char prefix, size_t i, int width) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%c%0*zu", prefix, width, i);
+        return string(buf);
+    };
+    
+    // 输出缓冲, 攒满1MB写一次
+    auto writer = [](const string& path) {
+        return make_unique<ofstream>(path, ios::binary | ios::trunc);
+    };
+    auto drain = [](ofstream& file, string& buf, bool force) {
+        if (force || buf.size() >= (1 << 20)) {
+            file.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    };
+    string buf;
+    
+    // 课程
+    static const char* const slots[] = {
+        "周一 08:00-10:00", "周一 14:00-16:00", "周二 09:00-11:00", "周三 10:00-12:00",
+        "周三 15:00-17:00", "周四 15:00-17:00", "周五 10:00-12:00", "周五 14:00-16:00",
+    };
+    vector<string> courseIds(spec.courses);
+    auto cfile = writer(COURSE_FILE);
+    for (size_t c = 0; c < spec.courses; c++) {
+        courseIds[c] = makeId('C', c, 5);
+        buf += courseIds[c] + "|课程" + to_string(c) + "|" + slots[pick(8)] + "|" + (pick(3) ? "B" : "X") + "\n";
+        drain(*cfile, buf, false);
+    }
+    drain(*cfile, buf, true);
+    
+    // 教师: 每门课至少一位教师, 每位教师另外按热度再教0-3门
+    vector<vector<uint32_t>> teachersOf(spec.courses), studentsOf(spec.courses);
+    vector<vector<uint32_t>> teaching(spec.teachers);
+    for (size_t c = 0; c < spec.courses; c++) {
+        teaching[c % spec.teachers].push_back(static_cast<uint32_t>(c));
+    }
+    auto tfile = writer(TEACHER_FILE);
+    for (size_t t = 0; t < spec.teachers; t++) {
+        vector<uint32_t>& list = teaching[t];
+        for (size_t extra = pick(4); extra > 0; extra--) {
+            uint32_t c = static_cast<uint32_t>(popular(rng));
+            if (find(list.begin(), list.end(), c) == list.end()) list.push_back(c);
+        }
+        buf += makeId('T', t, 5) + "|pass" + to_string(t % 1000) + "|";
+        for (size_t k = 0; k < list.size(); k++) {
+            teachersOf[list[k]].push_back(static_cast<uint32_t>(t));
+            buf += (k ? "," : "") + courseIds[list[k]];
+        }
+        buf += "\n";
+        drain(*tfile, buf, false);
+    }
+    drain(*tfile, buf, true);
+    
+    // 学生: 每人按热度选2-7门课
+    auto sfile = writer(STUDENT_FILE);
+    vector<uint32_t> list;
+    for (size_t s = 0; s < spec.students; s++) {
+        list.clear();
+        for (size_t want = 2 + pick(6); want > 0; want--) {
+            uint32_t c = static_cast<uint32_t>(popular(rng));
+            if (find(list.begin(), list.end(), c) == list.end()) list.push_back(c);
+        }
+        buf += makeId('S', s, 6) + "|pass" + to_string(s % 1000) + "|";
+        for (size_t k = 0; k < list.size(); k++) {
+            studentsOf[list[k]].push_back(static_cast<uint32_t>(s));
+            buf += (k ? "," : "") + courseIds[list[k]];
+        }
+        buf += "\n";
+        drain(*sfile, buf, false);
+    }
+    drain(*sfile, buf, true);
+    
+    // 答疑记录: 从2024-01-01起按行递增, 一年内排满
+    static const int ratingWeights[11] = {0, 2, 2, 3, 4, 6, 8, 12, 18, 22, 23};
+    discrete_distribution<int> ratingOf(ratingWeights, ratingWeights + 11);
+    int64_t start = daysFromCivil(2024, 1, 1) * 86400;
+    double step = 365.0 * 86400 / max<size_t>(spec.records, 1);
+    auto qfile = writer(QA_FILE);
+    for (size_t i = 0; i < spec.records; ) {
+        size_t c = popular(rng);
+        if (teachersOf[c].empty() || studentsOf[c].empty()) continue;
+        uint32_t t = teachersOf[c][pick(teachersOf[c].size())];
+        uint32_t s = studentsOf[c][pick(studentsOf[c].size())];
+        int rating = pick(4) == 0 ? 0 : ratingOf(rng);
+        int64_t time = start + static_cast<int64_t>(i * step);
+        buf += makeId('T', t, 5) + "|" + makeId('S', s, 6) + "|" + courseIds[c] + "|" +
+               formatTime(time) + "|" + to_string(rating) + "\n";
+        drain(*qfile, buf, false);
+        i++;
+    }
+    drain(*qfile, buf, true);
+    
+    remove(JOURNAL_FILE.c_str());
+    remove(SNAPSHOT_FILE.c_str());
+    cerr << "已生成: " << spec.teachers << " 位教师, " << spec.students << " 位学生, "
+         << spec.courses << " 门课程, " << spec.records << " 条答疑记录" << endl;
+    return 0;
+}
+
+// 基准测试: 在当前目录的数据上测量加载、保存和各项操作的耗时, 按CSV输出到标准输出:
+//   benchmark,ops,seconds,ns_per_op
+// 之后输出加载完成时和结束时的累计堆分配(需以QA_PROFILE编译)与峰值、当前RSS:
+//   memory,allocations,allocated_bytes,peak_rss_kb,rss_kb
+// 添加和评分在专用的教师/课程/学生上进行, 日志不逐条落盘, 也不在中途触发检查点;
+// 最后的saveData即一次检查点, 会改写数据文件, 应在数据副本上运行
+int runBenchmarks(SystemConfig config, unsigned ops) {
+    config.deferCommit = true;
+    config.checkpointRecords = numeric_limits<size_t>::max();
+    
+    auto now = [] { return chrono::steady_clock::now(); };
+    auto seconds = [](chrono::steady_clock::time_point since) {
+        return chrono::duration<double>(chrono::steady_clock::now() - since).count();
+    };
+    auto report = [](const char* name, size_t n, double secs) {
+        cout << name << "," << n << "," << fixed << setprecision(6) << secs << ","
+             << setprecision(1) << (n ? secs * 1e9 / n : 0.0) << '\n';
+    };
+    // 只读操作重复执行, 直到满max次或累计超过1秒
+    auto repeat = [&](const char* name, size_t max, auto op) {
+        auto t0 = now();
+        size_t n = 0;
+        while (n < max && (n == 0 || seconds(t0) < 1.0)) op(n++);
+        report(name, n, seconds(t0));
+    };
+    
+    cout << "benchmark,ops,seconds,ns_per_op" << '\n';
+    auto t0 = now();
+    ostringstream memory;
+    ManagementSystem system(config);
+    report("loadData", 1, seconds(t0));
+    reportMemory(memory, "loadData");
+    
+    const int STUDENTS = 64;
+    string tag = to_string(time(0));
+    string course = "BC" + tag;
+    ostringstream sink;
+    system.addNewCourse(course, "基准测试课程", "-", "必修", sink);
+    Teacher* teacher = system.authenticateTeacher("BT" + tag, "bench");
+    system.addTeacherCourse(teacher, course, sink);
+    vector<Student*> students;
+    for (int k = 0; k < STUDENTS; k++) {
+        students.push_back(system.authenticateStudent("BS" + tag + "-" + to_string(k), "bench"));
+        system.selectCourse(students.back(), course, sink);
+    }
+    
+    t0 = now();
+    for (unsigned i = 0; i < ops; i++) {
+        sink.str("");
+        system.addQA(teacher, students[i % STUDENTS]->getID(), course, sink);
+    }
+    report("addQA", ops, seconds(t0));
+    
+    t0 = now();
+    for (unsigned i = 0; i < ops; i++) {
+        sink.str("");
+        system.rateQA(students[i % STUDENTS], teacher->getID(), course, 1 + i % 10, sink);
+    }
+    report("rateQA", ops, seconds(t0));
+    
+    repeat("showRatings", ops, [&](size_t) {
+        sink.str("");
+        system.showRatings(teacher, sink);
+    });
+    repeat("displayAllCourses", ops, [&](size_t) {
+        sink.str("");
+        system.displayAllCourses(sink);
+    });
+    // 整份导出基准教师的答疑记录(共ops条)到/dev/null, 每次操作为一次完整导出
+    ofstream devnull("/dev/null");
+    repeat("displayQARecords", ops, [&](size_t) {
+        system.displayQARecords(teacher, devnull);
+    });
+    // 遍历全部学生, 以及按随机学号查找(密码不符, 只比较不登录)
+    vector<string> studentIds;
+    repeat("studentIDs", ops, [&](size_t) { studentIds = system.studentIDs(); });
+    mt19937 rng(1);
+    repeat("findStudent", ops, [&](size_t) {
+        system.authenticateStudent(studentIds[rng() % studentIds.size()], "\x01");
+    });
+    // 登录风暴: STORM_SESSIONS个会话同时登录STORM_USERS个已注册(密码为散列)的用户.
+    // 冷登录每次都要在认证线程池上计算散列; 之后的重复登录命中会话缓存
+    const size_t STORM_USERS = 256, STORM_SESSIONS = 32;
+    vector<string> stormIds;
+    for (size_t k = 0; k < STORM_USERS; k++) {
+        stormIds.push_back("BL" + tag + "-" + to_string(k));
+        system.authenticateStudent(stormIds.back(), "storm" + to_string(k));
+    }
+    auto storm = [&](const char* name, size_t logins) {
+        atomic<size_t> next(0), failed(0);
+        auto start = now();
+        vector<thread> sessions;
+        for (size_t t = 0; t < STORM_SESSIONS; t++) {
+            sessions.emplace_back([&] {
+                for (size_t i; (i = next++) < logins;) {
+                    size_t k = i % STORM_USERS;
+                    if (!system.authenticateStudent(stormIds[k], "storm" + to_string(k))) failed++;
+                }
+            });
+        }
+        for (thread& t : sessions) t.join();
+        report(name, logins, seconds(start));
+        if (failed) cerr << name << ": " << failed << " 次登录失败" << '\n';
+    };
+    system.clearSessions();
+    storm("login storm(cold)", STORM_USERS);
+    storm("login storm(cached)", max<size_t>(ops, STORM_USERS));
+    
+    // 随机学生的全部答疑记录: 记录分散在各页, 不在内存中的页要从文件读入
+    repeat("queryQARecords(student)", ops, [&](size_t) {
+        system.queryQARecords(QAStore::BY_STUDENT, studentIds[rng() % studentIds.size()], INT64_MIN, INT64_MAX);
+    });
+    
+    // 选课导入: 登录风暴的用户分成两半, 各选同样条数的随机课程, 前一半逐条selectCourse, 后一半一次importBulk
+    vector<string> courseIds = system.courseIDs();
+    vector<Student*> half;
+    for (size_t k = 0; k < STORM_USERS / 2; k++) {
+        half.push_back(system.authenticateStudent(stormIds[k], "storm" + to_string(k)));
+    }
+    t0 = now();
+    for (unsigned i = 0; i < ops; i++) {
+        sink.str("");
+        system.selectCourse(half[i % half.size()], courseIds[rng() % courseIds.size()], sink);
+    }
+    report("selectCourse", ops, seconds(t0));
+    ImportBatch batch;
+    for (unsigned i = 0; i < ops; i++) {
+        batch.enrollments.emplace_back(stormIds[STORM_USERS / 2 + i % half.size()], courseIds[rng() % courseIds.size()]);
+    }
+    t0 = now();
+    ImportSummary imported = system.importBulk(batch);
+    report("importBulk(enrollments)", ops, seconds(t0));
+    if (imported.unknownCourses || imported.unknownUsers) cerr << "importBulk: 有未找到的课程或学生" << '\n';
+    
+    // 保存: 先增量写出上面基准产生的修改, 再只改一个密码后保存, 最后整体重写作对照
+    t0 = now();
+    system.checkpoint();
+    report("saveData", 1, seconds(t0));
+    system.changePassword(teacher, "bench", sink);
+    t0 = now();
+    system.checkpoint();
+    report("saveData(one change)", 1, seconds(t0));
+    t0 = now();
+    system.checkpoint(true);
+    report("saveData(full)", 1, seconds(t0));
+    // 整体重写的检查点在另一线程进行时, 前台每隔0.1毫秒添加一条答疑, 报告总耗时和最慢的一次
+    atomic<bool> saving(true);
+    thread background([&] {
+        system.checkpoint(true);
+        saving = false;
+    });
+    double total = 0, slowest = 0;
+    size_t during = 0;
+    while (saving) {
+        t0 = now();
+        sink.str("");
+        system.addQA(teacher, students[during++ % STUDENTS]->getID(), course, sink);
+        total += seconds(t0);
+        slowest = max(slowest, seconds(t0));
+        this_thread::sleep_for(chrono::microseconds(100));
+    }
+    background.join();
+    report("addQA(during checkpoint)", during, total);
+    report("addQA(during checkpoint) slowest", 1, slowest);
+    reportMemory(memory, "end");
+    cout << "memory,allocations,allocated_bytes,peak_rss_kb,rss_kb" << '\n' << memory.str();
+    return 0;
+}
+
+// 并发压力测试: 每个线程用自己的教师、学生和课程反复添加答疑、评分、选退公共课程,
+// 并穿插读取其它线程的数据; 结束后核对每位教师的记录数和评分直方图与线程自己的计数一致.
+// 会写入当前目录的日志和数据文件, 应在单独的目录中运行
+int runStress(ManagementSystem& system, unsigned threads, unsigned ops) {
+    const int STUDENTS = 8;
+    struct Worker {
+        Teacher* teacher = nullptr;
+        vector<Student*> students;
+        string course;
+        size_t added = 0;
+        RatingStats rated;
+    };
+    
+    // 用启动时间区分多次运行, 保证每次都是新ID
+    string tag = to_string(time(0));
+    string shared = "SC" + tag + "-shared";
+    ostringstream setup;
+    system.addNewCourse(shared, "压力测试公共课程", "-", "选修", setup);
+    vector<Worker> workers(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        Worker& w = workers[i];
+        string suffix = tag + "-" + to_string(i);
+        w.course = "SC" + suffix;
+        system.addNewCourse(w.course, "压力测试课程", "-", "必修", setup);
+        w.teacher = system.authenticateTeacher("ST" + suffix, "stress");
+        system.addTeacherCourse(w.teacher, w.course, setup);
+        for (int k = 0; k < STUDENTS; k++) {
+            Student* s = system.authenticateStudent("SS" + suffix + "-" + to_string(k), "stress");
+            system.selectCourse(s, w.course, setup);
+            w.students.push_back(s);
+        }
+    }
+    
+    atomic<size_t> authErrors(0);
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back([&, i] {
+            Worker& w = workers[i];
+            mt19937 rng(i + 1);
+            ostringstream sink;
+            for (unsigned op = 0; op < ops; op++) {
+                sink.str("");
+                Student* s = w.students[rng() % STUDENTS];
+                const Worker& other = workers[rng() % threads];
+                switch (rng() % 8) {
+                case 0: case 1: case 2:
+                    if (system.addQA(w.teacher, s->getID(), w.course, sink)) w.added++;
+                    break;
+                case 3: case 4: {
+                    int rating = 1 + rng() % 10;
+                    if (system.rateQA(s, w.teacher->getID(), w.course, rating, sink)) w.rated.hist[rating]++;
+                    break;
+                }
+                case 5:
+                    system.showRatings(other.teacher, sink);
+                    break;
+                case 6:
+                    if (!system.selectCourse(s, shared, sink)) system.unselectCourse(s, shared, sink);
+                    break;
+                default:
+                    if (system.authenticateTeacher(other.teacher->getID(), "stress") != other.teacher) {
+                        authErrors++;
+                    }
+                    system.searchCourses(other.teacher, sink);
+                    break;
+                }
+            }
+        });
+    }
+    for (thread& t : pool) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    size_t mismatched = 0;
+    for (const Worker& w : workers) {
+        RatingStats st = system.teacherStats(w.teacher);
+        bool same = system.countQARecords(w.teacher) == w.added;
+        for (int v = 1; v <= 10; v++) same = same && st.hist[v] == w.rated.hist[v];
+        if (!same) mismatched++;
+    }
+    
+    size_t total = static_cast<size_t>(threads) * ops;
+    cout << "压力测试: " << threads << " 个线程, 共 " << total << " 次操作, 用时 "
+         << fixed << setprecision(2) << seconds << " 秒, " << setprecision(0)
+         << (seconds > 0 ? total / seconds : 0.0) << " 次/秒" << '\n';
+    size_t bad = 0;
+    if (!system.checkRatingAggregates(bad)) bad = 1;
+    mismatched += bad;
+    if (mismatched == 0 && authErrors == 0) {
+        cout << "一致性检查通过" << '\n';
+        return 0;
+    }
+    cout << "一致性检查失败: " << mismatched << " 位教师或课程的记录不一致, "
+         << authErrors << " 次登录返回了错误的对象" << '\n';
+    return 1;
+}
+
+// 批处理模式: 不经过菜单, 从脚本文件或标准输入逐行读取命令执行, 用于批量导入和可重复的性能测试.
+// 输出只在缓冲区满或结束时写出. 每行一条命令, 字段以'|'分隔(与数据文件相同), '#'开头为注释:
+//   login|teacher或student|ID|密码          登录(新ID自动注册), 后续命令以该身份执行
+//   logout                                  退出当前身份
+//   allcourses                              查看所有课程
+//   courses                                 查询当前用户的课程
+//   passwd|新密码                           修改当前用户的密码
+//   course|课程ID|名称|答疑时间|必修或选修   (教师) 新建课程并加入教授列表
+//   add|课程ID  drop|课程ID                  (教师) 添加/删除教授的课程
+//   addqa|学生ID|课程ID                     (教师) 添加答疑记录
+//   ratings  records                        (教师) 查看评分统计/答疑记录
+//   records|页码                            (教师) 分页查看答疑记录, 每页QA_PAGE_SIZE条
+//   select|课程ID  unselect|课程ID           (学生) 选修/退选课程
+//   rate|教师ID|课程ID|分数                 (学生) 为答疑评分
+//   roster|课程ID                           查看课程的授课教师和选课学生
+//   load                                    (教师) 查看授课课程数和选课总人次
+//   history|teacher或student或course|ID|起始|结束   查看时间段内的答疑记录
+//   report|起始|结束                        各教师在时间段内的答疑次数和评分统计
+//     (时间为 "YYYY-MM-DD" 或 "YYYY-MM-DD HH:MM", 含起始不含结束)
+//   stats|teacher或course|ID                教师或课程的评分统计
+//   board                                   所有教师的答疑次数和平均分
+//   verify                                  以全表重算校验增量评分统计
+//   profile                                 输出运行统计(需以QA_PROFILE编译)
+// 日志每BATCH_COMMIT_COMMANDS条命令落盘一次, 中途崩溃最多丢失最后一批命令.
+// 结束后在标准错误输出命令数和吞吐量
+const size_t BATCH_COMMIT_COMMANDS = 1024;
+const size_t QA_PAGE_SIZE = 100;
+
+// 批处理命令 import|enroll|文件, import|teach|文件, import|qa|文件: 读入CSV后整批交给importBulk.
+// 选课每行 "学号,课程号", 授课每行 "工号,课程号", 答疑记录每行 "工号,学号,课程号,YYYY-MM-DD HH:MM,评分"
+bool runImport(ManagementSystem& system, string_view kind, const string& path, ostream& out) {
+    ifstream file(path);
+    if (!file) {
+        out << "无法打开文件: " << path << '\n';
+        return false;
+    }
+    ImportBatch batch;
+    size_t malformed = 0;
+    string line;
+    while (getline(file, line)) {
+        trimLineEnd(line);
+        if (line.empty() || line[0] == '#') continue;
+        string_view f[5];
+        size_t n = splitView(line, ',', f, 5);
+        if (kind != "qa" && n == 2 && !f[0].empty() && !f[1].empty()) {
+            (kind == "enroll" ? batch.enrollments : batch.assignments).emplace_back(string(f[0]), string(f[1]));
+        } else if (kind == "qa" && n == 5 && isTimeText(f[3]) && !f[4].empty() && f[4].size() <= 2) {
+            batch.records.push_back({string(f[0]), string(f[1]), string(f[2]), parseTime(f[3]), parseInt(f[4])});
+        } else {
+            malformed++;
+        }
+    }
+    ImportSummary r = system.importBulk(batch);
+    out << "导入完成: 新增选课 " << r.enrollments << ", 新增授课 " << r.assignments
+        << ", 新增答疑记录 " << r.records << "; 重复 " << r.duplicates << ", 课程不存在 " << r.unknownCourses
+        << ", 用户不存在 " << r.unknownUsers << ", 不符合条件 " << r.rejected << ", 格式错误 " << malformed << '\n';
+    if (!r.durable) out << "本批修改未能写入日志, 重启后将会丢失!" << '\n';
+    return r.durable;
+}
+
+int runBatch(ManagementSystem& system, istream& in, ostream& out) {
+    Teacher* teacher = nullptr;
+    Student* student = nullptr;
+    size_t commands = 0, failed = 0, lineNo = 0;
+    string line;
+    auto start = chrono::steady_clock::now();
+    while (getline(in, line)) {
+        lineNo++;
+        trimLineEnd(line);
+        if (line.empty() || line[0] == '#') continue;
+        commands++;
+        
+        string_view f[5];
+        size_t n = splitView(line, '|', f, 5);
+        string_view cmd = f[0];
+        auto arg = [&f](size_t i) { return string(f[i]); };
+        bool ok = true;
+        if (cmd == "login" && n == 4 && (f[1] == "teacher" || f[1] == "student")) {
+            teacher = nullptr;
+            student = nullptr;
+            if (f[1] == "teacher") {
+                teacher = system.authenticateTeacher(arg(2), arg(3));
+                ok = teacher != nullptr;
+                if (!ok) out << "登录失败! 工号或密码错误." << '\n';
+            } else {
+                student = system.authenticateStudent(arg(2), arg(3));
+                ok = student != nullptr;
+                if (!ok) out << "登录失败! 学号或密码错误." << '\n';
+            }
+        } else if (cmd == "logout" && n == 1) {
+            teacher = nullptr;
+            student = nullptr;
+        } else if (cmd == "allcourses" && n == 1) {
+            system.displayAllCourses(out);
+        } else if (cmd == "roster" && n == 2) {
+            system.showCourseRoster(arg(1), out);
+        } else if (teacher && cmd == "load" && n == 1) {
+            pair<size_t, size_t> load = system.teachingLoad(teacher);
+            out << "教授课程: " << load.first << " 门, 选课总人次: " << load.second << '\n';
+        } else if (cmd == "history" && n == 5 &&
+                   (f[1] == "teacher" || f[1] == "student" || f[1] == "course")) {
+            int64_t from, to;
+            ok = parseTimeBound(f[3], from) && parseTimeBound(f[4], to);
+            if (ok) {
+                QAStore::Filter filter = f[1] == "teacher" ? QAStore::BY_TEACHER :
+                                         f[1] == "student" ? QAStore::BY_STUDENT : QAStore::BY_COURSE;
+                ok = system.showQAHistory(filter, arg(2), from, to, out);
+            } else {
+                out << "时间格式错误!" << '\n';
+            }
+        } else if (cmd == "stats" && n == 3 && (f[1] == "teacher" || f[1] == "course")) {
+            RatingStats st = f[1] == "teacher" ? system.teacherStats(arg(2)) : system.courseStats(arg(2));
+            if (st.count() == 0) {
+                out << "暂无评分记录!" << '\n';
+            } else {
+                OutputBuffer buf(out);
+                buf << "评分统计: 已评分: " << st.count() << ", 最高分: " << st.max()
+                    << ", 最低分: " << st.min() << ", 平均分: " << Decimal{st.average(), 1} << '\n';
+            }
+        } else if (cmd == "board" && n == 1) {
+            system.showRatingBoard(out);
+        } else if (cmd == "verify" && n == 1) {
+            size_t bad = 0;
+            ok = system.checkRatingAggregates(bad, out) && bad == 0;
+            if (ok) out << "评分统计一致" << '\n';
+            else if (bad) out << "评分统计不一致: " << bad << " 位教师或课程" << '\n';
+        } else if (cmd == "report" && n == 3) {
+            int64_t from, to;
+            ok = parseTimeBound(f[1], from) && parseTimeBound(f[2], to);
+            if (ok) ok = system.showTermReport(from, to, out);
+            else out << "时间格式错误!" << '\n';
+        } else if (cmd == "import" && n == 3 && (f[1] == "enroll" || f[1] == "teach" || f[1] == "qa")) {
+            ok = runImport(system, f[1], arg(2), out);
+        } else if (cmd == "profile" && n == 1) {
+            PROFILE_REPORT(out);
+        } else if (cmd == "courses" && n == 1 && (teacher || student)) {
+            if (teacher) system.searchCourses(teacher, out);
+            else system.searchCourses(student, out);
+        } else if (cmd == "passwd" && n == 2 && (teacher || student)) {
+            ok = teacher ? system.changePassword(teacher, arg(1), out)
+                         : system.changePassword(student, arg(1), out);
+        } else if (teacher && cmd == "course" && n == 5) {
+            // 与菜单一致: 课程已存在时仍加入教授列表
+            system.addNewCourse(arg(1), arg(2), arg(3), arg(4), out);
+            ok = system.addTeacherCourse(teacher, arg(1), out);
+        } else if (teacher && cmd == "add" && n == 2) {
+            ok = system.addTeacherCourse(teacher, arg(1), out);
+        } else if (teacher && cmd == "drop" && n == 2) {
+            ok = system.deleteTeacherCourse(teacher, arg(1), out);
+        } else if (teacher && cmd == "addqa" && n == 3) {
+            ok = system.addQA(teacher, arg(1), arg(2), out);
+        } else if (teacher && cmd == "ratings" && n == 1) {
+            system.showRatings(teacher, out);
+        } else if (teacher && cmd == "records" && n == 1) {
+            ok = system.displayQARecords(teacher, out);
+        } else if (teacher && cmd == "records" && n == 2 && f[1].size() <= 6 && parseInt(f[1]) > 0) {
+            ok = system.displayQARecords(teacher, out, (parseInt(f[1]) - 1) * QA_PAGE_SIZE, QA_PAGE_SIZE);
+        } else if (student && cmd == "select" && n == 2) {
+            ok = system.selectCourse(student, arg(1), out);
+        } else if (student && cmd == "unselect" && n == 2) {
+            ok = system.unselectCourse(student, arg(1), out);
+        } else if (student && cmd == "rate" && n == 4) {
+            ok = system.rateQA(student, arg(1), arg(2), parseInt(f[3]), out);
+        } else {
+            out << "第" << lineNo << "行: 无法执行的命令: " << line << '\n';
+            ok = false;
+        }
+        if (!ok) failed++;
+        // 修改攒到这里统一落盘, 前面的"成功"提示要以此为准
+        if (commands % BATCH_COMMIT_COMMANDS == 0 && !system.commitPending()) {
+            out << "第" << lineNo << "行及之前命令的修改未能写入日志, 重启后将会丢失!" << '\n';
+            failed++;
+        }
+    }
+    if (!system.commitPending()) {
+        out << "批处理的修改未能写入日志, 重启后将会丢失!" << '\n';
+        failed++;
+    }
+    out.flush();
+    
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "批处理: " << commands << " 条命令, " << failed << " 条未成功, 用时 "
+         << fixed << setprecision(3) << seconds << " 秒, " << setprecision(0)
+         << (seconds > 0 ? commands / seconds : 0.0) << " 条/秒" << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+#ifdef QA_PROFILE
+    // 退出时(在系统析构、日志提交之后)向标准错误输出运行统计
+    struct ExitReport {
+        ~ExitReport() { PROFILE_REPORT(cerr); }
+    } exitReport;
+#endif
+    SystemConfig config;
+    unsigned stressThreads = 0;
+    unsigned ops = 0; // 压力测试和基准测试的操作次数, 0表示各自的默认值
+    bool batch = false;
+    string batchFile;
+    bool generate = false;
+    bool bench = false;
+    DatasetSpec spec;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            config.loadThreads = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (arg == "--resident" && i + 1 < argc) {
+            // --resident N: 内存中最多保留约N条答疑记录, 其余换出到文件, 用到时再读入. 按整页计, N向上取整到
+            // QA_CHUNK_ROWS(4096)条的倍数, 至少一页; 只有已写入答疑文本文件且此后没有修改的整页才能换出,
+            // 从二进制快照加载或批量导入(importBulk)的页要等文本格式的检查点写入文件后才受此限制,
+            // --format binary时始终常驻
+            config.residentRecords = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--auth-threads" && i + 1 < argc) {
+            config.authThreads = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (arg == "--hash-iterations" && i + 1 < argc) {
+            // --hash-iterations N: 新设置的密码使用的PBKDF2迭代次数, 已有散列按各自记录的次数校验
+            config.hashIterations = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--format") {
+            // --format text|binary: 检查点写出的格式; 其它取值报错退出, 不当作text
+            string format = i + 1 < argc ? argv[++i] : "";
+            if (format != "text" && format != "binary") {
+                cerr << "用法: --format text|binary" << endl;
+                return 1;
+            }
+            config.format = format == "binary" ? SnapshotFormat::BINARY : SnapshotFormat::TEXT;
+        } else if (arg == "--convert") {
+            // --convert text2bin: 读文本写二进制; bin2text: 读二进制写文本
+            string direction = i + 1 < argc ? argv[++i] : "";
+            if (direction != "text2bin" && direction != "bin2text") {
+                cerr << "用法: --convert text2bin|bin2text" << endl;
+                return 1;
+            }
+            config.format = direction == "bin2text" ? SnapshotFormat::BINARY : SnapshotFormat::TEXT;
+            ManagementSystem system(config);
+            system.convertSnapshot();
+            return 0;
+        } else if (arg == "--stress" && i + 1 < argc) {
+            // --stress N [--ops M]: N个线程各执行M次操作(默认2000)
+            stressThreads = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (arg == "--ops" && i + 1 < argc) {
+            ops = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (arg == "--gen") {
+            // --gen [--teachers N] [--students N] [--courses N] [--records N] [--skew S] [--seed N]
+            generate = true;
+        } else if (arg == "--teachers" && i + 1 < argc) {
+            spec.teachers = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--students" && i + 1 < argc) {
+            spec.students = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--courses" && i + 1 < argc) {
+            spec.courses = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--records" && i + 1 < argc) {
+            spec.records = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--skew" && i + 1 < argc) {
+            spec.skew = atof(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            spec.seed = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--bench") {
+            // --bench [--ops M]: 添加/评分各M次(默认100000), 只读操作最多M次
+            bench = true;
+        } else if (arg == "--batch") {
+            // --batch [脚本文件], 省略文件时从标准输入读取
+            batch = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') batchFile = argv[++i];
+        }
+    }
+    
+    if (generate) {
+        return generateDataset(spec);
+    }
+    if (bench) {
+        return runBenchmarks(config, ops ? ops : 100000);
+    }
+    
+    // 批处理时cout使用自己的缓冲区, 读取脚本也不触发cout刷新; 日志按批落盘
+    if (batch) {
+        config.deferCommit = true;
+        ios::sync_with_stdio(false);
+        cin.tie(nullptr);
+    }
+    
+    // 初始化系统数据
+    initializeSystemData();
+    
+    ManagementSystem system(config);
+    if (stressThreads > 0) {
+        return runStress(system, stressThreads, ops ? ops : 2000);
+    }
+    if (batch) {
+        if (batchFile.empty()) return runBatch(system, cin, cout);
+        ifstream script(batchFile);
+        if (!script) {
+            cerr << "无法打开批处理文件: " << batchFile << endl;
+            return 1;
+        }
+        return runBatch(system, script, cout);
+    }
+    
+    while (true) {
+        cout << "\n==============================================" << '\n';
+        cout << "      教师在线答疑辅导管理系统 - 主菜单       " << '\n';
+        cout << "==============================================" << '\n';
+        cout << "1. 教师登录" << '\n';
+        cout << "2. 学生登录" << '\n';
+        cout << "3. 查看所有课程" << '\n';
+        cout << "4. 退出系统" << '\n';
+        cout << "==============================================" << '\n';
+        cout << "请选择: ";
+        
+        int choice;
+        cin >> choice;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        
+        if (choice == 4) {
+            // 每次修改都已写入日志, 退出时无需重写全部数据文件
+            cout << "数据已保存，感谢使用!" << '\n';
+            break;
+        }
+        
+        string id, pwd;
+        if (choice == 1 || choice == 2) {
+            cout << "请输入ID: ";
+            getline(cin, id);
+            cout << "请输入密码: ";
+            getline(cin, pwd);
+        }
+        
+        if (choice == 1) {
+            Teacher* teacher = system.authenticateTeacher(id, pwd);
+            if (teacher) {
+                teacherMenu(teacher, system);
+            } else {
+                cout << "登录失败! 工号或密码错误." << '\n';
+            }
+        } else if (choice == 2) {
+            Student* student = system.authenticateStudent(id, pwd);
+            if (student) {
+                studentMenu(student, system);
+            } else {
+                cout << "登录失败! 学号或密码错误." << '\n';
+            }
+        } else if (choice == 3) {
+            system.displayAllCourses();
+        } else {
+            cout << "无效选择!" << '\n';
+        }
+    }
+    
+    return 0;
+}
+
+void teacherMenu(Teacher* teacher, ManagementSystem& system) {
+    while (true) {
+        cout << "\n==============================================" << '\n';
+        cout << "      教师管理菜单 (" << teacher->getID() << ")       " << '\n';
+        cout << "==============================================" << '\n';
+        cout << "1. 添加课程" << '\n';
+        cout << "2. 删除课程" << '\n';
+        cout << "3. 查询课程" << '\n';
+        cout << "4. 添加答疑记录" << '\n';
+        cout << "5. 查看评分统计" << '\n';
+        cout << "6. 查看答疑记录" << '\n';
+        cout << "7. 修改密码" << '\n';
+        cout << "8. 返回主菜单" << '\n';
+        cout << "==============================================" << '\n';
+        cout << "请选择: ";
+        
+        int choice;
+        cin >> choice;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        
+        if (choice == 8) break;
+        
+        string cid, sid;
+        switch (choice) {
+            case 1: { // 添加课程
+                string id, name, time, type;
+                cout << "请输入课程ID: ";
+                getline(cin, id);
+                cout << "请输入课程名称: ";
+                getline(cin, name);
+                cout << "请输入答疑时间: ";
+                getline(cin, time);
+                cout << "请输入课程类型(必修/选修): ";
+                getline(cin, type);
+                
+                // 添加新课程到系统
+                system.addNewCourse(id, name, time, type);
+                // 添加课程到教师
+                system.addTeacherCourse(teacher, id);
+                break;
+            }
+                
+            case 2: // 删除课程
+                system.searchCourses(teacher);
+                cout << "请输入要删除的课程ID: ";
+                getline(cin, cid);
+                system.deleteTeacherCourse(teacher, cid);
+                break;
+                
+            case 3: // 查询课程
+                system.searchCourses(teacher);
+                break;
+                
+            case 4: // 添加答疑记录
+                cout << "请输入学生ID: ";
+                getline(cin, sid);
+                cout << "请输入课程ID: ";
+                getline(cin, cid);
+                system.addQA(teacher, sid, cid);
+                break;
+                
+            case 5: // 查看评分统计
+                system.showRatings(teacher);
+                break;
+                
+            case 6: // 查看答疑记录
+                system.displayQARecords(teacher);
+                break;
+                
+            case 7: { // 修改密码
+                string newPwd;
+                cout << "请输入新密码: ";
+                getline(cin, newPwd);
+                system.changePassword(teacher, newPwd);
+                break;
+            }
+                
+            default:
+                cout << "无效选择!" << '\n';
+        }
+    }
+}
+
+void studentMenu(Student* student, ManagementSystem& system) {
+    while (true) {
+        cout << "\n==============================================" << '\n';
+        cout << "      学生管理菜单 (" << student->getID() << ")       " << '\n';
+        cout << "==============================================" << '\n';
+        cout << "1. 选修课程" << '\n';
+        cout << "2. 退选课程" << '\n';
+        cout << "3. 查询课程" << '\n';
+        cout << "4. 查询答疑信息" << '\n';
+        cout << "5. 修改密码" << '\n';
+        cout << "6. 返回主菜单" << '\n';
+        cout << "==============================================" << '\n';
+        cout << "请选择: ";
+        
+        int choice;
+        cin >> choice;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        
+        if (choice == 6) break;
+        
+        string cid, tid;
+        switch (choice) {
+            case 1: // 选修课程
+                system.displayAllCourses();
+                cout << "请输入要选修的课程ID: ";
+                getline(cin, cid);
+                system.selectCourse(student, cid);
+                break;
+                
+            case 2: // 退选课程
+                system.searchCourses(student);
+                cout << "请输入要退选的课程ID: ";
+                getline(cin, cid);
+                system.unselectCourse(student, cid);
+                break;
+                
+            case 3: // 查询课程
+                system.searchCourses(student);
+                break;
+                
+            case 4: // 查询答疑信息
+                system.searchCourses(student);
+                cout << "请输入课程ID: ";
+                getline(cin, cid);
+                cout << "请输入教师ID: ";
+                getline(cin, tid);
+                system.rateQA(student, tid, cid);
+                break;
+                
+            case 5: { // 修改密码
+                string newPwd;
+                cout << "请输入新密码: ";
+                getline(cin, newPwd);
+                system.changePassword(student, newPwd);
+                break;
+            }
+   
+            default:
+                cout << "无效选择!" << '\n';
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#!/bin/sh
+# 回归测试: --format/--convert的取值写错时要报用法并以非0退出, 不能当作text或text2bin照常运行、改写数据文件
+# 用法: tests/bad_format_option.sh (在仓库根目录运行)
+set -e
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+g++ -std=c++17 -O2 -o "$work/cs" "$root/cs.cpp" -lpthread
+cp "$root"/teachers.dat "$root"/students.dat "$root"/courses.dat "$root"/qa_records.dat "$work"
+cd "$work"
+before=$(ls)
+for args in "--convert bin2txt" "--convert" "--format bin --batch" "--format"; do
+    status=0
+    out=$(echo verify | ./cs $args 2>&1) || status=$?
+    echo "$args: $out"
+    [ "$status" -ne 0 ] || { echo "FAIL: $args accepted"; exit 1; }
+    echo "$out" | grep -q '^用法: --' || { echo "FAIL: no usage for $args"; exit 1; }
+done
+[ "$(ls)" = "$before" ] || { echo "FAIL: data files created"; exit 1; }
+for f in teachers.dat students.dat courses.dat qa_records.dat; do
+    cmp -s "$f" "$root/$f" || { echo "FAIL: $f modified"; exit 1; }
+done
+echo "PASS"
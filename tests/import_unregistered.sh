@@ -0,0 +1,18 @@
+#!/bin/sh
+# 回归测试: 批量导入只在答疑记录中出现过、未注册的ID(仓库数据中的教师"1")时应计入"用户不存在", 不能崩溃
+# 用法: tests/import_unregistered.sh (在仓库根目录运行)
+set -e
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+g++ -std=c++17 -O2 -o "$work/cs" "$root/cs.cpp" -lpthread
+cp "$root"/teachers.dat "$root"/students.dat "$root"/courses.dat "$root"/qa_records.dat "$work"
+cd "$work"
+printf '1,C101\nT001,C201\n' > teach.csv
+printf '1,S1001,C101,2025-06-16 10:20,8\nT001,S1001,C101,2025-06-17 10:00,7\n' > qa.csv
+out=$(printf 'import|teach|teach.csv\nimport|qa|qa.csv\nverify\n' | ./cs --batch 2>/dev/null)
+echo "$out"
+echo "$out" | grep -q '新增授课 1, .*用户不存在 1,' || { echo "FAIL: import|teach"; exit 1; }
+echo "$out" | grep -q '新增答疑记录 1;.*用户不存在 1,' || { echo "FAIL: import|qa"; exit 1; }
+echo "$out" | grep -q '^评分统计一致' || { echo "FAIL: verify"; exit 1; }
+echo "PASS"
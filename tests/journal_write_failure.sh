@@ -0,0 +1,21 @@
+#!/bin/sh
+# 回归测试: 日志写不进去(文件大小限制为0)时批处理不能只报"成功", 日志中不能留下写了一半的记录
+# 用法: tests/journal_write_failure.sh (在仓库根目录运行)
+set -e
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+g++ -std=c++17 -O2 -o "$work/cs" "$root/cs.cpp" -lpthread
+cp "$root"/teachers.dat "$root"/students.dat "$root"/courses.dat "$root"/qa_records.dat "$work"
+cd "$work"
+# 只对被测进程限制文件大小并忽略SIGXFSZ, 输出经管道交给不受限制的cat
+out=$(printf 'login|student|S1001|pass789\nselect|C102\n' |
+      sh -c "trap '' XFSZ; ulimit -f 0; exec ./cs --batch" 2>&1 | cat)
+echo "$out"
+echo "$out" | grep -q '未能写入日志' || { echo "FAIL: failure not reported"; exit 1; }
+echo "$out" | grep -q '1 条未成功' || { echo "FAIL: failed command not counted"; exit 1; }
+[ ! -s journal.log ] || { echo "FAIL: journal.log not truncated"; exit 1; }
+# 限制解除后照常落盘, 重启后能看到
+printf 'login|student|S1001|pass789\nselect|C102\n' | ./cs --batch > /dev/null 2>&1
+printf 'login|student|S1001|pass789\ncourses\n' | ./cs --batch 2>/dev/null | grep -q 'C102' || { echo "FAIL: later write lost"; exit 1; }
+echo "PASS"
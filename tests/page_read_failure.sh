@@ -0,0 +1,20 @@
+#!/bin/sh
+# 回归测试: 换出的答疑记录页读不回来(答疑文件在运行中被截断)时查询要报错, 不能把缺的行当作全零记录输出
+# 用法: tests/page_read_failure.sh (在仓库根目录运行)
+set -e
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+g++ -std=c++17 -O2 -o "$work/cs" "$root/cs.cpp" -lpthread
+cp "$root"/teachers.dat "$root"/students.dat "$root"/courses.dat "$root"/qa_records.dat "$work"
+cd "$work"
+# 三页多的记录, 内存中只留一页, 前面的整页加载时即换出
+awk 'BEGIN { for (i = 0; i < 13000; i++) print "T002|S1002|C201|2025-05-10 09:00|7" }' > qa_records.dat
+status=0
+out=$( { sleep 2; : > qa_records.dat; printf 'history|teacher|T002|2025-05-01|2025-06-01\nreport|2025-05-01|2025-06-01\nverify\n'; } |
+      ./cs --resident 1 --batch 2>/dev/null) || status=$?
+echo "$out"
+[ "$status" -eq 0 ] || { echo "FAIL: exit $status"; exit 1; }
+[ "$(echo "$out" | grep -c '答疑记录失败')" -eq 3 ] || { echo "FAIL: read failure not reported"; exit 1; }
+echo "$out" | grep -q '学期报表\|共 .* 条, 已评分\|评分统计' && { echo "FAIL: served a partial result"; exit 1; }
+echo "PASS"
@@ -0,0 +1,19 @@
+#!/bin/sh
+# 回归测试: 日志中评分超出范围的R记录、评分字段超出0-10的Q记录重放时应被忽略, 不能越界写评分统计
+# 用法: tests/replay_bad_rating.sh (在仓库根目录运行)
+set -e
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+g++ -std=c++17 -O2 -o "$work/cs" "$root/cs.cpp" -lpthread
+cp "$root"/teachers.dat "$root"/students.dat "$root"/courses.dat "$root"/qa_records.dat "$work"
+cd "$work"
+printf 'Q|T001|S1001|C101|2025-06-20 10:00\nR|T001|S1001|C101|99\nQ|T001|S1001|C101|2025-06-21 10:00|300\n' > journal.log
+status=0
+out=$(printf 'verify\nhistory|teacher|T001|2025-06-20|2025-06-22\n' | ./cs --batch 2>/dev/null) || status=$?
+echo "$out"
+[ "$status" -eq 0 ] || { echo "FAIL: exit $status"; exit 1; }
+echo "$out" | grep -q '^评分统计一致' || { echo "FAIL: verify"; exit 1; }
+echo "$out" | grep -q '2025-06-21' && { echo "FAIL: Q record with rating 300 replayed"; exit 1; }
+echo "$out" | grep -q '2025-06-20.*评分: 0/10' || { echo "FAIL: out-of-range R record applied"; exit 1; }
+echo "PASS"